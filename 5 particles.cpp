@@ -8,16 +8,23 @@
 #include <cmath>
 #include <cstdlib>
 #include <ctime>
+#include "spatial_hash.h"
+#include "sim_clock.h"
+#include "particle_renderer.h"
+#include "shader_program.h"
+#include "gl_context.h"
 //#include <Windows.h>
 
 const char* vertexShaderSource = "#version 330 core\n"
 "layout (location = 0) in vec3 aPos;\n"
 //"layout (location = 0) in vec3 aPos2;\n"
-"uniform mat4 view;\n"
+"layout (location = 1) in float aX;\n"
+"layout (location = 2) in float aY;\n"
+"layout (location = 3) in float aZ;\n"
 //"uniform mat4 view2;\n"
 "void main()\n"
 "{\n"
-"   gl_Position = view * vec4(aPos, 1.0);\n"
+"   gl_Position = vec4(aPos + vec3(aX, aY, aZ), 1.0);\n"
 //"   gl_Position2 = view2 * vec4(aPos2, 1.0);\n"
 "}\0";
 
@@ -72,78 +79,22 @@ const unsigned int SCR_HEIGHT = 800;
 
 int main()
 {
-    // glfw: инициализация и конфигурирование
-    glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-#ifdef __APPLE__
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE); // раскомментируйте эту строку, если используете macOS
-#endif
-
-    // glfw: создание окна
-    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "OpenGL Project", NULL, NULL);
-    if (window == NULL)
-    {
-        std::cout << "Failed to create GLFW window" << std::endl;
-        glfwTerminate();
-        return -1;
-    }
-    glfwMakeContextCurrent(window);
-    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-
-    // glad: загрузка всех указателей на OpenGL-функции
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
-    {
-        std::cout << "Failed to initialize GLAD" << std::endl;
+    // Окно GLFW или, если задана CLOTH_HEADLESS, контекст без окна, который
+    // рисует во внеэкранный буфер кадра (см. gl_context.h)
+    GlContext context;
+    if (!context.create(SCR_WIDTH, SCR_HEIGHT, "OpenGL Project"))
         return -1;
-    }
+    GLFWwindow* window = context.window();
+    // Без окна функциям GLFW нечего передать: окно NULL, а GLFW не инициализирован
+    if (window)
+        glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 
     // Компилирование нашей шейдерной программы
 
-    // Вершинный шейдер
-    int vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-    glCompileShader(vertexShader);
-
-    // Проверка на наличие ошибок компилирования вершинного шейдера
-    int success;
-    char infoLog[512];
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-    if (!success)
-    {
-        glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
-    }
-
-    // Фрагментный шейдер
-    int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-    glCompileShader(fragmentShader);
-
-    // Проверка на наличие ошибок компилирования фрагментного шейдера
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-    if (!success)
-    {
-        glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
-    }
-
-    // Связывание шейдеров
-    int shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-
-    // Проверка на наличие ошибок компилирования связывания шейдеров
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-    if (!success) {
-        glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
-    }
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+    // SHADER_CACHE=папка сохраняет собранную программу в двоичном виде, и
+    // следующие запуски не компилируют шейдеры
+    ShaderProgram program;
+    program.build(vertexShaderSource, NULL, fragmentShaderSource, getenv("SHADER_CACHE"));
 
     // Указывание вершин (и буферов) и настройка вершинных атрибутов
    float vertices[] = {
@@ -193,6 +144,10 @@ int main()
     // Модификация других VAO требует вызов glBindVertexArray(), поэтому мы обычно не снимаем привязку VAO (или VBO), когда это не требуется напрямую
     glBindVertexArray(VAO);
 
+    // Частицы рисуются одним instanced-вызовом за кадр: положения всех
+    // частиц загружаются в буфер экземпляров, а не по матрице на частицу
+    ParticleRenderer renderer;
+    renderer.init(VBO, 6, GL_TRIANGLES);
 
     // Раскомментируйте следующую строку для отрисовки полигонов в режиме каркаса
     // glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
@@ -222,10 +177,15 @@ int main()
     //double vx2 = -0.009, vy2 = 0.008;
     // Цикл рендеринга
     double border = 0.95;
+    const float collision_radius = 0.1f;
+    SpatialHash hash(collision_radius);
+    SimClock clock(1.0 / 60.0);
+    std::vector<glm::vec3> prev_locations = particles_locations;
+    std::vector<glm::vec3> draw_locations = particles_locations;
 
     //int step = 0;
     //int n = 5; //number of particles
-    while (!glfwWindowShouldClose(window))
+    while (!context.should_close())
     {
         // Обработка ввода
         processInput(window);
@@ -235,81 +195,74 @@ int main()
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
         // Рисуем наш первый треугольник
-        glUseProgram(shaderProgram);
+        program.use();
         //glBindVertexArray(VAO); // поскольку у нас есть только один VАО, то нет необходимости связывать его каждый раз (но мы сделаем это, чтобы всё было немного организованнее)
         glPointSize(15);
 
+        // Между шагами физики рисуем промежуточное положение
+        float alpha = (float)clock.alpha();
+
         //Particle particle;
         for (int i = 0; i < particles_locations.size(); i++) {
-            glm::mat4 view = glm::mat4(1.0f);
-            view = glm::translate(view, particles_locations[i]);
-            //view = glm::translate(view, glm::vec3(vertices[3], vertices[4], 0.0f));
-            unsigned int viewLoc = glGetUniformLocation(shaderProgram, "view");
-            glUniformMatrix4fv(viewLoc, 1, GL_FALSE, &view[0][0]);
-            //glBindVertexArray(VAO);
-            //glDrawArrays(GL_POINTS, 0, particles_locations.size());
-            glDrawArrays(GL_TRIANGLES, 0, 6);
-
+            draw_locations[i] = glm::mix(prev_locations[i], particles_locations[i], alpha);
         }
+        renderer.draw(&draw_locations[0].x, (int)draw_locations.size());
         //glm::mat4 view = glm::mat4(1.0f);
         //glm::mat4 view2 = glm::mat4(1.0f);
 
-        for (int i = 0; i < particles_locations.size(); i++) {
+        // Шаги физики фиксированной длины 1/60 с: скорости заданы за шаг,
+        // поэтому на мониторах 60 и 240 Гц частицы движутся одинаково
+        int steps = clock.tick(context.time());
+        for (int s = 0; s < steps; ++s) {
+            if (s == steps - 1)
+                prev_locations = particles_locations;
+            for (int i = 0; i < particles_locations.size(); i++) {
 
-            //vertices[i] += speed[i]; //+ particle.get_vx();
+                //vertices[i] += speed[i]; //+ particle.get_vx();
 
-            particles_locations[i].x += velocityX[i];
-            particles_locations[i].y += velocityY[i];
-            particles_locations[i].z += 0;
+                particles_locations[i].x += velocityX[i];
+                particles_locations[i].y += velocityY[i];
+                particles_locations[i].z += 0;
 
-            if (particles_locations[i].x >= border || particles_locations[i].x <= (-1) * border) {
-                //vertices[i] = border;
-                //speed[i + 1] *= -1;
-                //speed[i] *= -1;
-                velocityX[i] *= -1;
+                if (particles_locations[i].x >= border || particles_locations[i].x <= (-1) * border) {
+                    //vertices[i] = border;
+                    //speed[i + 1] *= -1;
+                    //speed[i] *= -1;
+                    velocityX[i] *= -1;
 
-            }
+                }
 
-            //else if (vertices[i] < (-1) * border) {
-                //vertices[i] = -1 * border;
-               // speed[i] *= -1;
-                //speed[i+1] *= -1;
-            //}
+                //else if (vertices[i] < (-1) * border) {
+                    //vertices[i] = -1 * border;
+                   // speed[i] *= -1;
+                    //speed[i+1] *= -1;
+                //}
 
-            //vertices[i + 1] += speed[i + 1];// + particle.get_vy();;
+                //vertices[i + 1] += speed[i + 1];// + particle.get_vy();;
 
-            if (particles_locations[i].y > border || particles_locations[i].y < (-1) * border) {
-                // vertices[i+1] = border;
-                velocityY[i] *= -1;
-                //speed[i + 1] *= -1;
-                //speed[i] *= -1;
-            }
-            //else if (vertices[i+1] < -1 * border) {
-                //vertices[i+1] = -1 * border;
-               //speed[i+1] *= -1;
-                //speed[i] *= -1;
-           // }
-        }
-            for (int i = 0; i < particles_locations.size() ; i++) {
-                for (int j = i + 1; j < particles_locations.size(); j++) {
-
-                    float dx = particles_locations[i].x - particles_locations[j].x;
-                    float dy = particles_locations[i].y - particles_locations[j].y;
-
-                    if (sqrt( dx*dx + dy*dy ) <= 0.1f) {
-
-                        velocityX[i] *= -1;
-                        velocityX[j] *= -1;
-                        velocityY[i] *= -1;
-                        velocityY[j] *= -1;
-                        //vertices[i] -= 0.001;
-                        //vertices[i + 1] -= 0.001;
-                        //vertices[j] += 0.001;
-                        //vertices[j + 1] += 0.001;
-                    }
+                if (particles_locations[i].y > border || particles_locations[i].y < (-1) * border) {
+                    // vertices[i+1] = border;
+                    velocityY[i] *= -1;
+                    //speed[i + 1] *= -1;
+                    //speed[i] *= -1;
                 }
-    
+                //else if (vertices[i+1] < -1 * border) {
+                    //vertices[i+1] = -1 * border;
+                   //speed[i+1] *= -1;
+                    //speed[i] *= -1;
+               // }
             }
+            // Столкновения ищем через пространственный хеш с ячейкой, равной радиусу
+            // взаимодействия: проверяются только соседние ячейки, а не все пары частиц
+            hash.build(&particles_locations[0].x, &particles_locations[0].y, &particles_locations[0].z,
+                (int)particles_locations.size(), 3);
+            hash.for_each_pair(collision_radius, [&](int i, int j, float) {
+                velocityX[i] *= -1;
+                velocityX[j] *= -1;
+                velocityY[i] *= -1;
+                velocityY[j] *= -1;
+            });
+        }
 
             //view = glm::translate(view, glm::vec3(vertices[i], vertices[i + 1], 0.0f));
             //view = glm::translate(view, glm::vec3(vertices[3], vertices[4], 0.0f));
@@ -339,22 +292,28 @@ int main()
       //glBindVertexArray(0); // не нужно каждый раз его отвязывать
 
      // glfw: обмен содержимым front- и back- буферов. Отслеживание событий ввода\вывода (была ли нажата/отпущена кнопка, перемещен курсор мыши и т.п.)
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        context.swap();
+        if (window)
+            glfwPollEvents();
     }
 
     // Опционально: освобождаем все ресурсы, как только они выполнили свое предназначение
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
+    renderer.release();
+    program.release();
 
-    // glfw: завершение, освобождение всех ранее задействованных GLFW-ресурсов
-    glfwTerminate();
+    // glfw: завершение, освобождение всех ранее задействованных GLFW-ресурсов (или контекста без окна)
+    context.destroy();
     return 0;
 }
 
 // Обработка всех событий ввода: запрос GLFW о нажатии/отпускании кнопки мыши в данном кадре и соответствующая обработка данных событий
 void processInput(GLFWwindow* window)
 {
+    // Без окна (CLOTH_HEADLESS) ввода нет
+    if (!window)
+        return;
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
 }
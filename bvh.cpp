@@ -0,0 +1,289 @@
+#include "bvh.h"
+#include <algorithm>
+#include <cfloat>
+
+static float dot3(const float a[3], const float b[3]) {
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static void sub3(const float a[3], const float b[3], float out[3]) {
+    out[0] = a[0] - b[0]; out[1] = a[1] - b[1]; out[2] = a[2] - b[2];
+}
+
+// Real-Time Collision Detection, 5.1.5: find the Voronoi region of p.
+void closest_point_on_triangle(const float p[3], const float a[3], const float b[3],
+    const float c[3], float out[3], float bary[3]) {
+    float ab[3], ac[3], ap[3];
+    sub3(b, a, ab);
+    sub3(c, a, ac);
+    sub3(p, a, ap);
+    float u = 1.0f, v = 0.0f, w = 0.0f;
+
+    float d1 = dot3(ab, ap), d2 = dot3(ac, ap);
+    if (d1 <= 0.0f && d2 <= 0.0f) {
+        u = 1.0f; v = 0.0f; w = 0.0f;       // vertex a
+    } else {
+        float bp[3];
+        sub3(p, b, bp);
+        float d3 = dot3(ab, bp), d4 = dot3(ac, bp);
+        float cp[3];
+        sub3(p, c, cp);
+        float d5 = dot3(ab, cp), d6 = dot3(ac, cp);
+        float vc = d1 * d4 - d3 * d2;
+        float vb = d5 * d2 - d1 * d6;
+        float va = d3 * d6 - d5 * d4;
+
+        if (d3 >= 0.0f && d4 <= d3) {
+            u = 0.0f; v = 1.0f; w = 0.0f;   // vertex b
+        } else if (d6 >= 0.0f && d5 <= d6) {
+            u = 0.0f; v = 0.0f; w = 1.0f;   // vertex c
+        } else if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+            v = d1 / (d1 - d3);             // edge ab
+            u = 1.0f - v; w = 0.0f;
+        } else if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+            w = d2 / (d2 - d6);             // edge ac
+            u = 1.0f - w; v = 0.0f;
+        } else if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) {
+            w = (d4 - d3) / ((d4 - d3) + (d5 - d6));    // edge bc
+            v = 1.0f - w; u = 0.0f;
+        } else {
+            float denom = 1.0f / (va + vb + vc);        // inside the face
+            v = vb * denom;
+            w = vc * denom;
+            u = 1.0f - v - w;
+        }
+    }
+
+    for (int k = 0; k < 3; ++k)
+        out[k] = u * a[k] + v * b[k] + w * c[k];
+    bary[0] = u; bary[1] = v; bary[2] = w;
+}
+
+TriangleBvh::TriangleBvh() {
+    x = y = z = NULL;
+    stride = 1;
+    built_area = 0.0f;
+    rebuild_ratio = 2.0f;
+}
+
+void TriangleBvh::triangle_bounds(int t, float lo[3], float hi[3]) const {
+    float v[3];
+    vertex(tris[3 * t], v);
+    for (int k = 0; k < 3; ++k)
+        lo[k] = hi[k] = v[k];
+    for (int c = 1; c < 3; ++c) {
+        vertex(tris[3 * t + c], v);
+        for (int k = 0; k < 3; ++k) {
+            lo[k] = std::min(lo[k], v[k]);
+            hi[k] = std::max(hi[k], v[k]);
+        }
+    }
+}
+
+void TriangleBvh::build(const float* x, const float* y, const float* z, int stride,
+    const int* triangles, int triangle_count) {
+    this->x = x;
+    this->y = y;
+    this->z = z;
+    this->stride = stride;
+    tris.assign(triangles, triangles + 3 * (size_t)triangle_count);
+    nodes.clear();
+    order.resize(triangle_count);
+    if (triangle_count <= 0) {
+        built_area = 0.0f;
+        return;
+    }
+
+    centroids.resize(3 * (size_t)triangle_count);
+    for (int t = 0; t < triangle_count; ++t) {
+        order[t] = t;
+        float lo[3], hi[3];
+        triangle_bounds(t, lo, hi);
+        for (int k = 0; k < 3; ++k)
+            centroids[3 * t + k] = 0.5f * (lo[k] + hi[k]);
+    }
+
+    nodes.reserve(2 * (size_t)triangle_count);
+    nodes.push_back(Node());
+    split(0, 0, triangle_count);
+    built_area = area_sum();
+}
+
+// Median split along the widest axis of the centroids; leaves hold up to
+// four triangles.
+void TriangleBvh::split(int node, int begin, int end) {
+    Node n;
+    n.lo[0] = n.lo[1] = n.lo[2] = FLT_MAX;
+    n.hi[0] = n.hi[1] = n.hi[2] = -FLT_MAX;
+    float clo[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+    float chi[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    for (int i = begin; i < end; ++i) {
+        float lo[3], hi[3];
+        triangle_bounds(order[i], lo, hi);
+        const float* c = &centroids[3 * order[i]];
+        for (int k = 0; k < 3; ++k) {
+            n.lo[k] = std::min(n.lo[k], lo[k]);
+            n.hi[k] = std::max(n.hi[k], hi[k]);
+            clo[k] = std::min(clo[k], c[k]);
+            chi[k] = std::max(chi[k], c[k]);
+        }
+    }
+
+    int axis = 0;
+    for (int k = 1; k < 3; ++k)
+        if (chi[k] - clo[k] > chi[axis] - clo[axis])
+            axis = k;
+
+    if (end - begin <= 4 || chi[axis] <= clo[axis]) {
+        n.first = begin;
+        n.count = end - begin;
+        nodes[node] = n;
+        return;
+    }
+
+    const int mid = (begin + end) / 2;
+    std::nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end,
+        [&](int a, int b) { return centroids[3 * a + axis] < centroids[3 * b + axis]; });
+
+    n.first = (int)nodes.size();
+    n.count = 0;
+    nodes[node] = n;
+    nodes.push_back(Node());
+    nodes.push_back(Node());
+    split(n.first, begin, mid);
+    split(n.first + 1, mid, end);
+}
+
+void TriangleBvh::refit(const float* x, const float* y, const float* z, int stride) {
+    this->x = x;
+    this->y = y;
+    this->z = z;
+    this->stride = stride;
+    refit();
+}
+
+// Children always come after their parent, so one backward pass sees every
+// child before its parent.
+void TriangleBvh::refit() {
+    for (int i = (int)nodes.size() - 1; i >= 0; --i) {
+        Node& n = nodes[i];
+        if (n.count > 0) {
+            triangle_bounds(order[n.first], n.lo, n.hi);
+            for (int k = n.first + 1; k < n.first + n.count; ++k) {
+                float lo[3], hi[3];
+                triangle_bounds(order[k], lo, hi);
+                for (int a = 0; a < 3; ++a) {
+                    n.lo[a] = std::min(n.lo[a], lo[a]);
+                    n.hi[a] = std::max(n.hi[a], hi[a]);
+                }
+            }
+        } else {
+            const Node& l = nodes[n.first];
+            const Node& r = nodes[n.first + 1];
+            for (int a = 0; a < 3; ++a) {
+                n.lo[a] = std::min(l.lo[a], r.lo[a]);
+                n.hi[a] = std::max(l.hi[a], r.hi[a]);
+            }
+        }
+    }
+}
+
+bool TriangleBvh::update() {
+    refit();
+    if (built_area > 0.0f && quality() > rebuild_ratio) {
+        std::vector<int> copy(tris);
+        build(x, y, z, stride, copy.data(), (int)copy.size() / 3);
+        return true;
+    }
+    return false;
+}
+
+float TriangleBvh::area_sum() const {
+    float sum = 0.0f;
+    for (const Node& n : nodes) {
+        float dx = n.hi[0] - n.lo[0], dy = n.hi[1] - n.lo[1], dz = n.hi[2] - n.lo[2];
+        sum += dx * dy + dy * dz + dz * dx;
+    }
+    return sum;
+}
+
+float TriangleBvh::quality() const {
+    return built_area > 0.0f ? area_sum() / built_area : 1.0f;
+}
+
+void TriangleBvh::bounds(float lo[3], float hi[3]) const {
+    for (int k = 0; k < 3; ++k) {
+        lo[k] = nodes.empty() ? 0.0f : nodes[0].lo[k];
+        hi[k] = nodes.empty() ? 0.0f : nodes[0].hi[k];
+    }
+}
+
+float TriangleBvh::dist2_to_box(const Node& n, const float p[3]) {
+    float d2 = 0.0f;
+    for (int k = 0; k < 3; ++k) {
+        float d = std::max(std::max(n.lo[k] - p[k], p[k] - n.hi[k]), 0.0f);
+        d2 += d * d;
+    }
+    return d2;
+}
+
+// Nearer child first, and boxes farther than the best hit so far are skipped.
+// The stack keeps the box distance computed when the node was pushed, so
+// every box is measured once.
+bool TriangleBvh::closest(const float p[3], float radius, BvhHit& hit) const {
+    if (nodes.empty())
+        return false;
+    float best = radius * radius;
+    bool found = false;
+    int stack[64];
+    float stack_d2[64];
+    int top = 0;
+    stack[top] = 0;
+    stack_d2[top++] = dist2_to_box(nodes[0], p);
+    while (top > 0) {
+        --top;
+        if (stack_d2[top] > best)
+            continue;
+        const Node& n = nodes[stack[top]];
+        if (n.count > 0) {
+            for (int k = n.first; k < n.first + n.count; ++k) {
+                const int t = order[k];
+                float a[3], b[3], c[3], q[3], bary[3];
+                vertex(tris[3 * t], a);
+                vertex(tris[3 * t + 1], b);
+                vertex(tris[3 * t + 2], c);
+                closest_point_on_triangle(p, a, b, c, q, bary);
+                float d[3];
+                sub3(p, q, d);
+                float d2 = dot3(d, d);
+                if (d2 <= best) {
+                    best = d2;
+                    found = true;
+                    hit.triangle = t;
+                    hit.dist2 = d2;
+                    for (int i = 0; i < 3; ++i) {
+                        hit.point[i] = q[i];
+                        hit.bary[i] = bary[i];
+                    }
+                }
+            }
+        } else {
+            int near = n.first, far = n.first + 1;
+            float near_d2 = dist2_to_box(nodes[near], p);
+            float far_d2 = dist2_to_box(nodes[far], p);
+            if (far_d2 < near_d2) {
+                std::swap(near, far);
+                std::swap(near_d2, far_d2);
+            }
+            if (far_d2 <= best) {
+                stack[top] = far;
+                stack_d2[top++] = far_d2;
+            }
+            if (near_d2 <= best) {
+                stack[top] = near;
+                stack_d2[top++] = near_d2;
+            }
+        }
+    }
+    return found;
+}
@@ -0,0 +1,109 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <cstddef>
+#include <vector>
+
+// Closest point on triangle (a, b, c) to p. Writes the point and its
+// barycentric weights for a, b and c.
+void closest_point_on_triangle(const float p[3], const float a[3], const float b[3],
+    const float c[3], float out[3], float bary[3]);
+
+struct BvhHit {
+    int triangle;       // index into the triangle list given to build()
+    float point[3];     // closest point on that triangle
+    float bary[3];      // barycentric weights of its three corners
+    float dist2;        // squared distance to the query point
+};
+
+// Bounding volume hierarchy over a triangle mesh. Vertex k is
+// (x[k * stride], y[k * stride], z[k * stride]), so both separate arrays and
+// interleaved xyz work; the arrays are read again by refit() and the
+// queries and must stay alive. Triangles are three vertex indices each and
+// are copied.
+//
+// A deforming mesh keeps its tree and only has the boxes refitted every
+// step, which is linear and cheap. Refitting lets the boxes grow and
+// overlap, so update() rebuilds once the total box area has grown past
+// rebuild_ratio times the area right after the last build.
+class TriangleBvh {
+public:
+    TriangleBvh();
+
+    void build(const float* x, const float* y, const float* z, int stride,
+        const int* triangles, int triangle_count);
+    // Recomputes the boxes from the current vertex positions, the tree
+    // stays the same. Pass new arrays if the vertices moved in memory.
+    void refit();
+    void refit(const float* x, const float* y, const float* z, int stride);
+    // Refits and rebuilds if the tree got too loose; returns true on rebuild.
+    bool update();
+
+    void set_rebuild_ratio(float ratio) { rebuild_ratio = ratio; }
+    // Total box area now divided by the total right after the last build.
+    float quality() const;
+
+    bool empty() const { return nodes.empty(); }
+    int triangle_count() const { return (int)tris.size() / 3; }
+    const int* triangle(int t) const { return &tris[3 * t]; }
+    void bounds(float lo[3], float hi[3]) const;
+
+    // Calls fn(t) for every triangle whose box comes within radius of p.
+    template <class F>
+    void for_each_near(const float p[3], float radius, F fn) const;
+
+    // Closest triangle to p within radius; false if there is none.
+    bool closest(const float p[3], float radius, BvhHit& hit) const;
+
+    void vertex(int v, float out[3]) const {
+        const size_t s = (size_t)v * stride;
+        out[0] = x[s]; out[1] = y[s]; out[2] = z[s];
+    }
+
+private:
+    struct Node {
+        float lo[3], hi[3];
+        int first;      // leaf: first entry of order, inner: left child (right is first + 1)
+        int count;      // triangles in a leaf, 0 for inner nodes
+    };
+
+    void split(int node, int begin, int end);
+    void triangle_bounds(int t, float lo[3], float hi[3]) const;
+    float area_sum() const;
+    static float dist2_to_box(const Node& n, const float p[3]);
+
+    const float* x;
+    const float* y;
+    const float* z;
+    int stride;
+    std::vector<int> tris;
+    std::vector<int> order;             // triangles ordered leaf by leaf
+    std::vector<Node> nodes;            // children always follow their parent
+    std::vector<float> centroids;       // scratch for build()
+    float built_area;
+    float rebuild_ratio;
+};
+
+template <class F>
+void TriangleBvh::for_each_near(const float p[3], float radius, F fn) const {
+    if (nodes.empty())
+        return;
+    const float r2 = radius * radius;
+    int stack[64];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        const Node& n = nodes[stack[--top]];
+        if (dist2_to_box(n, p) > r2)
+            continue;
+        if (n.count > 0) {
+            for (int k = n.first; k < n.first + n.count; ++k)
+                fn(order[k]);
+        } else {
+            stack[top++] = n.first;
+            stack[top++] = n.first + 1;
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,409 @@
+// Benchmark of whole cloth steps: runs ClothSolver headless for every grid
+// size, solver variant and thread count and reports steps per second, the
+// time per particle per solver iteration and the peak resident memory.
+//
+//     cloth_bench [options]
+//       --sizes 9x51,64x64,...   grids as columns x rows; the default goes
+//                                from 9x51 (many_moving_lawyers) to 2048x2048
+//       --threads 1,2,4          thread counts; default 1, 2, 4, ... up to
+//                                the hardware threads
+//       --methods explicit,xpbd,xpbd_collide,implicit
+//       --min-time 0.5           seconds to time every configuration for
+//       --csv results.csv        also write CSV
+//       --json results.json      also write JSON, usable as a baseline
+//       --compare baseline.json  exit with 1 if steps/s of any configuration
+//       --threshold 0.1          dropped more than this fraction below the
+//                                baseline
+//       --trace trace.json       write the profiling zones as a Chrome trace
+//
+// Built with CLOTH_PROFILE, every configuration is followed by the time
+// spent in each phase of the solver (see profiler.h).
+//
+// An iteration is one constraint sweep for XPBD (iterations x substeps per
+// step), one conjugate gradient iteration for the implicit method and the
+// step itself for the explicit one. The implicit solver runs on the calling
+// thread, so it is only timed with one thread.
+
+#include "cloth_solver.h"
+#include "job_system.h"
+#include "profiler.h"
+#include "simd_kernels.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <psapi.h>
+#elif defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+// Peak resident set of the process in bytes. On Linux the peak is reset
+// before every configuration, so it is that configuration's own; elsewhere
+// it is the peak of the run so far.
+static void reset_peak_rss() {
+#if defined(__linux__)
+    if (FILE* f = fopen("/proc/self/clear_refs", "w")) {
+        fputs("5", f);
+        fclose(f);
+    }
+#endif
+}
+
+static double peak_rss() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+        return (double)pmc.PeakWorkingSetSize;
+    return 0;
+#elif defined(__APPLE__)
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return (double)ru.ru_maxrss;        // bytes on macOS
+#else
+    double kb = 0;
+    if (FILE* f = fopen("/proc/self/status", "r")) {
+        char line[256];
+        while (fgets(line, sizeof(line), f)) {
+            if (strncmp(line, "VmHWM:", 6) == 0)
+                kb = atof(line + 6);
+        }
+        fclose(f);
+    }
+    return kb * 1024;
+#endif
+}
+
+struct Config {
+    std::string method;
+    int cols;
+    int rows;
+    int threads;
+};
+
+struct Result {
+    Config config;
+    int steps;
+    double steps_per_s;
+    double ns_per_particle_iteration;
+    double peak_rss_mb;
+};
+
+// The scene of many_moving_lawyers at any size: the top row pinned, the
+// rest pushed sideways harder the lower it hangs, a unit of cloth height.
+static void setup(ClothSolver& cloth, const std::string& method) {
+    const int rows = cloth.rows();
+    const int cols = cloth.cols();
+    if (method == "explicit") {
+        cloth.set_method(ClothSolver::EXPLICIT);
+    } else if (method == "implicit") {
+        cloth.set_method(ClothSolver::IMPLICIT);
+    } else {
+        cloth.set_method(ClothSolver::XPBD);
+        if (method == "xpbd_collide")
+            cloth.xpbd().set_collision_radius(0.8f * cloth.get_spacing());
+    }
+    for (int j = 0; j < cols; ++j)
+        cloth.pin(0, j);
+    for (int i = 1; i < rows; ++i) {
+        const float push = 1.5f * i / (rows > 1 ? rows - 1 : 1);
+        for (int j = 0; j < cols; ++j)
+            cloth.set_velocity(i, j, push, 0.0f, 0.0f);
+    }
+}
+
+static Result run(const Config& c, double min_time) {
+    JobSystem jobs(c.threads);
+    reset_peak_rss();
+    const int longest = c.rows > c.cols ? c.rows : c.cols;
+    ClothSolver cloth(c.rows, c.cols, 1.0f / longest, 0.0f, 0.8f, 0.0f);
+    cloth.set_jobs(&jobs);
+    setup(cloth, c.method);
+
+    const float dt = 1.0f / 60.0f;
+    cloth.step(dt);     // builds the constraints, warms the caches
+
+    int steps = 0;
+    double iterations = 0;
+    double elapsed = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    while (steps < 2 || elapsed < min_time) {
+        cloth.step(dt);
+        ++steps;
+        if (c.method == "explicit")
+            iterations += 1;
+        else if (c.method == "implicit")
+            iterations += cloth.implicit().last_iterations() > 0 ? cloth.implicit().last_iterations() : 1;
+        else
+            iterations += (double)cloth.xpbd().get_iterations() * cloth.xpbd().get_substeps();
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    }
+
+    Result r;
+    r.config = c;
+    r.steps = steps;
+    r.steps_per_s = steps / elapsed;
+    r.ns_per_particle_iteration = elapsed * 1e9 / (iterations * cloth.size());
+    r.peak_rss_mb = peak_rss() / (1024.0 * 1024.0);
+    return r;
+}
+
+static std::vector<std::string> split(const char* list) {
+    std::vector<std::string> out;
+    std::string item;
+    for (const char* s = list; ; ++s) {
+        if (*s == ',' || *s == 0) {
+            if (!item.empty())
+                out.push_back(item);
+            item.clear();
+            if (*s == 0)
+                break;
+        } else {
+            item += *s;
+        }
+    }
+    return out;
+}
+
+static std::string key_of(const Config& c) {
+    char key[128];
+    snprintf(key, sizeof(key), "%s %dx%d t%d", c.method.c_str(), c.cols, c.rows, c.threads);
+    return key;
+}
+
+static void write_csv(FILE* f, const std::vector<Result>& results) {
+    fprintf(f, "method,cols,rows,particles,threads,steps,steps_per_s,ns_per_particle_iteration,peak_rss_mb\n");
+    for (const Result& r : results) {
+        fprintf(f, "%s,%d,%d,%d,%d,%d,%.4f,%.4f,%.1f\n", r.config.method.c_str(), r.config.cols,
+            r.config.rows, r.config.cols * r.config.rows, r.config.threads, r.steps, r.steps_per_s,
+            r.ns_per_particle_iteration, r.peak_rss_mb);
+    }
+}
+
+static void write_json(FILE* f, const std::vector<Result>& results) {
+    fprintf(f, "{\n  \"isa\": \"%s\",\n  \"hardware_threads\": %u,\n  \"results\": [\n",
+        cloth_kernels().name, std::thread::hardware_concurrency());
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        fprintf(f, "    { \"method\": \"%s\", \"cols\": %d, \"rows\": %d, \"threads\": %d, \"steps\": %d, "
+            "\"steps_per_s\": %.4f, \"ns_per_particle_iteration\": %.4f, \"peak_rss_mb\": %.1f }%s\n",
+            r.config.method.c_str(), r.config.cols, r.config.rows, r.config.threads, r.steps,
+            r.steps_per_s, r.ns_per_particle_iteration, r.peak_rss_mb, i + 1 < results.size() ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+}
+
+// Value of "key" in one flat JSON object, as text without quotes.
+static bool json_field(const std::string& object, const char* key, std::string& value) {
+    const std::string quoted = std::string("\"") + key + "\"";
+    size_t at = object.find(quoted);
+    if (at == std::string::npos)
+        return false;
+    at = object.find(':', at + quoted.size());
+    if (at == std::string::npos)
+        return false;
+    ++at;
+    while (at < object.size() && (object[at] == ' ' || object[at] == '\t' || object[at] == '\n' || object[at] == '\r'))
+        ++at;
+    size_t end;
+    if (at < object.size() && object[at] == '"') {
+        ++at;
+        end = object.find('"', at);
+    } else {
+        end = object.find_first_of(",} \t\r\n", at);
+    }
+    if (end == std::string::npos)
+        return false;
+    value = object.substr(at, end - at);
+    return true;
+}
+
+// Results of a file write_json wrote: the flat objects of "results".
+static bool read_baseline(const char* path, std::vector<Result>& baseline) {
+    FILE* f = fopen(path, "rb");
+    if (!f)
+        return false;
+    std::string text;
+    char buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0)
+        text.append(buffer, n);
+    fclose(f);
+
+    size_t at = text.find("\"results\"");
+    if (at == std::string::npos)
+        return false;
+    while ((at = text.find('{', at)) != std::string::npos) {
+        size_t end = text.find('}', at);
+        if (end == std::string::npos)
+            break;
+        const std::string object = text.substr(at, end - at + 1);
+        std::string method, cols, rows, threads, steps_per_s;
+        if (json_field(object, "method", method) && json_field(object, "cols", cols)
+            && json_field(object, "rows", rows) && json_field(object, "threads", threads)
+            && json_field(object, "steps_per_s", steps_per_s)) {
+            Result r = Result();
+            r.config.method = method;
+            r.config.cols = atoi(cols.c_str());
+            r.config.rows = atoi(rows.c_str());
+            r.config.threads = atoi(threads.c_str());
+            r.steps_per_s = atof(steps_per_s.c_str());
+            baseline.push_back(r);
+        }
+        at = end + 1;
+    }
+    return true;
+}
+
+// Prints every configuration found in both; false if any got slower than
+// the baseline by more than threshold.
+static bool compare(const std::vector<Result>& results, const std::vector<Result>& baseline, double threshold) {
+    bool ok = true;
+    int compared = 0;
+    printf("\n%-32s %12s %12s %8s\n", "compared to baseline", "baseline/s", "now/s", "change");
+    for (const Result& r : results) {
+        for (const Result& b : baseline) {
+            if (key_of(b.config) != key_of(r.config) || b.steps_per_s <= 0)
+                continue;
+            const double change = r.steps_per_s / b.steps_per_s - 1.0;
+            const bool regressed = change < -threshold;
+            printf("%-32s %12.2f %12.2f %+7.1f%%%s\n", key_of(r.config).c_str(), b.steps_per_s,
+                r.steps_per_s, change * 100.0, regressed ? "  REGRESSION" : "");
+            ok = ok && !regressed;
+            ++compared;
+        }
+    }
+    if (compared == 0)
+        printf("no configuration in common with the baseline\n");
+    return ok;
+}
+
+int main(int argc, char* argv[]) {
+    const char* sizes_arg = "9x51,32x32,64x64,128x128,256x256,512x512,1024x1024,2048x2048";
+    const char* methods_arg = "explicit,xpbd,xpbd_collide,implicit";
+    const char* threads_arg = NULL;
+    const char* csv_path = NULL;
+    const char* json_path = NULL;
+    const char* baseline_path = NULL;
+    const char* trace_path = NULL;
+    double min_time = 0.5;
+    double threshold = 0.1;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!value) {
+            fprintf(stderr, "%s needs a value\n", arg);
+            return 2;
+        }
+        if (strcmp(arg, "--sizes") == 0)
+            sizes_arg = value;
+        else if (strcmp(arg, "--methods") == 0)
+            methods_arg = value;
+        else if (strcmp(arg, "--threads") == 0)
+            threads_arg = value;
+        else if (strcmp(arg, "--min-time") == 0)
+            min_time = atof(value);
+        else if (strcmp(arg, "--csv") == 0)
+            csv_path = value;
+        else if (strcmp(arg, "--json") == 0)
+            json_path = value;
+        else if (strcmp(arg, "--compare") == 0)
+            baseline_path = value;
+        else if (strcmp(arg, "--threshold") == 0)
+            threshold = atof(value);
+        else if (strcmp(arg, "--trace") == 0)
+            trace_path = value;
+        else {
+            fprintf(stderr, "unknown option %s\n", arg);
+            return 2;
+        }
+        ++i;
+    }
+
+    std::vector<int> thread_counts;
+    if (threads_arg) {
+        for (const std::string& t : split(threads_arg))
+            thread_counts.push_back(atoi(t.c_str()));
+    } else {
+        const int hardware = std::thread::hardware_concurrency() > 0 ? (int)std::thread::hardware_concurrency() : 1;
+        for (int t = 1; t < hardware; t *= 2)
+            thread_counts.push_back(t);
+        thread_counts.push_back(hardware);
+    }
+
+    std::vector<Config> configs;
+    for (const std::string& size : split(sizes_arg)) {
+        Config c;
+        if (sscanf(size.c_str(), "%dx%d", &c.cols, &c.rows) != 2 || c.cols < 1 || c.rows < 2) {
+            fprintf(stderr, "bad size %s, expected columns x rows\n", size.c_str());
+            return 2;
+        }
+        for (const std::string& method : split(methods_arg)) {
+            if (method != "explicit" && method != "xpbd" && method != "xpbd_collide" && method != "implicit") {
+                fprintf(stderr, "unknown method %s\n", method.c_str());
+                return 2;
+            }
+            c.method = method;
+            for (int threads : thread_counts) {
+                if (method == "implicit" && threads != thread_counts[0])
+                    continue;
+                c.threads = method == "implicit" ? 1 : threads;
+                configs.push_back(c);
+            }
+        }
+    }
+
+    std::vector<Result> baseline;
+    if (baseline_path && !read_baseline(baseline_path, baseline)) {
+        fprintf(stderr, "can't read baseline %s\n", baseline_path);
+        return 2;
+    }
+
+    printf("isa %s, %u hardware threads, %.2f s per configuration\n", cloth_kernels().name,
+        std::thread::hardware_concurrency(), min_time);
+    printf("%-14s %11s %8s %7s %12s %14s %10s\n", "method", "grid", "threads", "steps", "steps/s",
+        "ns/particle/it", "peak MB");
+    std::vector<Result> results;
+    for (const Config& c : configs) {
+        Result r = run(c, min_time);
+        char grid[32];
+        snprintf(grid, sizeof(grid), "%dx%d", c.cols, c.rows);
+        printf("%-14s %11s %8d %7d %12.2f %14.3f %10.1f\n", c.method.c_str(), grid, c.threads, r.steps,
+            r.steps_per_s, r.ns_per_particle_iteration, r.peak_rss_mb);
+        if (profile_enabled() && r.steps_per_s > 0) {
+            profile_print_histogram(stdout, r.steps / r.steps_per_s);
+            printf("\n");
+        }
+        fflush(stdout);
+        results.push_back(r);
+    }
+
+    if (csv_path) {
+        if (FILE* f = fopen(csv_path, "w")) {
+            write_csv(f, results);
+            fclose(f);
+        } else {
+            fprintf(stderr, "can't write %s\n", csv_path);
+        }
+    }
+    if (json_path) {
+        if (FILE* f = fopen(json_path, "w")) {
+            write_json(f, results);
+            fclose(f);
+        } else {
+            fprintf(stderr, "can't write %s\n", json_path);
+        }
+    }
+    if (trace_path && !profile_write_trace(trace_path))
+        fprintf(stderr, "can't write %s%s\n", trace_path, profile_enabled() ? "" : ", built without CLOTH_PROFILE");
+    if (baseline_path && !compare(results, baseline, threshold))
+        return 1;
+    return 0;
+}
@@ -0,0 +1,304 @@
+#include "cloth_solver.h"
+#include "simd_kernels.h"
+#include "profiler.h"
+#include <cmath>
+
+void ClothParticles::resize(int rows, int cols) {
+    this->rows = rows;
+    this->cols = cols;
+    size_t n = (size_t)rows * cols;
+    x.assign(n, 0.0f);
+    y.assign(n, 0.0f);
+    z.assign(n, 0.0f);
+    vx.assign(n, 0.0f);
+    vy.assign(n, 0.0f);
+    vz.assign(n, 0.0f);
+    inv_mass.assign(n, 1.0f);
+}
+
+ClothSolver::ClothSolver(int rows, int cols, float spacing,
+    float origin_x, float origin_y, float origin_z) {
+    this->spacing = spacing;
+    gravity[0] = 0.0f; gravity[1] = -9.81f; gravity[2] = 0.0f;
+    wind[0] = 0.0f; wind[1] = 0.0f; wind[2] = 0.0f;
+    damping = 0.0f;
+    method = EXPLICIT;
+    jobs = NULL;
+    thickness = 0.5f * spacing;
+
+    p.resize(rows, cols);
+    for (int i = 0; i < rows; ++i) {
+        for (int j = 0; j < cols; ++j) {
+            int k = p.index(i, j);
+            p.x[k] = origin_x + j * spacing;
+            p.y[k] = origin_y - i * spacing;
+            p.z[k] = origin_z;
+        }
+    }
+}
+
+void ClothSolver::set_gravity(float gx, float gy, float gz) {
+    gravity[0] = gx; gravity[1] = gy; gravity[2] = gz;
+}
+
+void ClothSolver::set_wind(float wx, float wy, float wz) {
+    wind[0] = wx; wind[1] = wy; wind[2] = wz;
+}
+
+void ClothSolver::set_damping(float damping) {
+    this->damping = damping;
+}
+
+int ClothSolver::add_collider(const float* vertices, int vertex_count,
+    const int* triangles, int triangle_count) {
+    std::unique_ptr<Collider> c(new Collider);
+    c->vertices.assign(vertices, vertices + 3 * (size_t)vertex_count);
+    const float* v = c->vertices.data();
+    c->bvh.build(v, v + 1, v + 2, 3, triangles, triangle_count);
+    colliders.push_back(std::move(c));
+    return (int)colliders.size() - 1;
+}
+
+void ClothSolver::move_collider(int id, const float* vertices) {
+    Collider& c = *colliders[id];
+    std::copy(vertices, vertices + c.vertices.size(), c.vertices.begin());
+    c.bvh.update();
+}
+
+void ClothSolver::remove_colliders() {
+    colliders.clear();
+}
+
+void ClothSolver::set_thickness(float thickness) {
+    this->thickness = thickness > 0.0f ? thickness : 0.0f;
+}
+
+void ClothSolver::set_method(Method method) {
+    this->method = method;
+}
+
+void ClothSolver::set_velocity(int row, int col, float vx, float vy, float vz) {
+    int k = p.index(row, col);
+    p.vx[k] = vx; p.vy[k] = vy; p.vz[k] = vz;
+}
+
+void ClothSolver::pin(int row, int col) {
+    int k = p.index(row, col);
+    p.inv_mass[k] = 0.0f;
+    p.vx[k] = 0.0f; p.vy[k] = 0.0f; p.vz[k] = 0.0f;
+}
+
+// Cross product of the central differences along the row and down the
+// column; one-sided differences at the borders.
+void ClothSolver::compute_normals(std::vector<float>& normals) const {
+    normals.resize(3 * (size_t)p.size());
+    const int rows = p.rows, cols = p.cols;
+    float* out = normals.data();
+
+    parallel_for(jobs, rows, 16, [&](int begin, int end) {
+        for (int i = begin; i < end; ++i) {
+            int up = i > 0 ? i - 1 : i;
+            int down = i + 1 < rows ? i + 1 : i;
+            for (int j = 0; j < cols; ++j) {
+                int left = p.index(i, j > 0 ? j - 1 : j);
+                int right = p.index(i, j + 1 < cols ? j + 1 : j);
+                int top = p.index(up, j);
+                int bottom = p.index(down, j);
+
+                float ux = p.x[right] - p.x[left], uy = p.y[right] - p.y[left], uz = p.z[right] - p.z[left];
+                float vx = p.x[top] - p.x[bottom], vy = p.y[top] - p.y[bottom], vz = p.z[top] - p.z[bottom];
+                float nx = uy * vz - uz * vy;
+                float ny = uz * vx - ux * vz;
+                float nz = ux * vy - uy * vx;
+                float len = sqrtf(nx * nx + ny * ny + nz * nz);
+                float inv = len > 0.0f ? 1.0f / len : 0.0f;
+
+                float* n = out + 3 * (size_t)p.index(i, j);
+                n[0] = nx * inv; n[1] = ny * inv; n[2] = nz * inv;
+            }
+        }
+    });
+}
+
+void ClothSolver::step(float dt) {
+    if (dt <= 0.0f)
+        return;
+    PROFILE_ZONE("step");
+    if (method == XPBD) {
+        const int substeps = xpbd_solver.get_substeps();
+        const float h = dt / substeps;
+        for (int s = 0; s < substeps; ++s) {
+            xpbd_solver.begin_step(p, jobs);
+            integrate(h);
+            xpbd_solver.solve(p, h, jobs);
+            if (!colliders.empty())
+                collide_meshes();
+            xpbd_solver.end_step(p, h, jobs);
+        }
+    } else if (method == IMPLICIT) {
+        float accel[3] = { gravity[0] + wind[0], gravity[1] + wind[1], gravity[2] + wind[2] };
+        implicit_solver.step(p, dt, accel);
+        PROFILE_ZONE("drag");
+        apply_drag(dt);
+    } else {
+        integrate(dt);
+    }
+}
+
+// Semi-implicit Euler: gravity, wind and drag in one pass over the arrays.
+void ClothSolver::integrate(float dt) {
+    PROFILE_ZONE("integrate");
+    const float accel[3] = { gravity[0] + wind[0], gravity[1] + wind[1], gravity[2] + wind[2] };
+    const float keep = damping * dt < 1.0f ? 1.0f - damping * dt : 0.0f;
+    const ClothKernels& kernels = cloth_kernels();
+    parallel_for(jobs, p.size(), 4096, [&](int begin, int end) {
+        kernels.integrate(p, begin, end, accel, keep, dt);
+    });
+}
+
+void ClothSolver::apply_drag(float dt) {
+    if (damping <= 0.0f)
+        return;
+    const int n = p.size();
+    const float keep = damping * dt < 1.0f ? 1.0f - damping * dt : 0.0f;
+    for (int i = 0; i < n; ++i) {
+        p.vx[i] *= keep;
+        p.vy[i] *= keep;
+        p.vz[i] *= keep;
+    }
+}
+
+static void triangle_normal(const TriangleBvh& bvh, int t, float n[3]) {
+    const int* v = bvh.triangle(t);
+    float a[3], b[3], c[3];
+    bvh.vertex(v[0], a);
+    bvh.vertex(v[1], b);
+    bvh.vertex(v[2], c);
+    float u[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+    float w[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+    n[0] = u[1] * w[2] - u[2] * w[1];
+    n[1] = u[2] * w[0] - u[0] * w[2];
+    n[2] = u[0] * w[1] - u[1] * w[0];
+    float len = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    float inv = len > 0.0f ? 1.0f / len : 0.0f;
+    n[0] *= inv; n[1] *= inv; n[2] *= inv;
+}
+
+// Cloth particles against collider triangles, then collider vertices
+// against cloth triangles, so that neither side pokes through the other.
+void ClothSolver::collide_meshes() {
+    PROFILE_ZONE("collide_meshes");
+    if (cloth_bvh.empty()) {
+        cloth_triangles.clear();
+        for (int i = 0; i + 1 < p.rows; ++i) {
+            for (int j = 0; j + 1 < p.cols; ++j) {
+                int a = p.index(i, j), b = p.index(i, j + 1);
+                int c = p.index(i + 1, j), d = p.index(i + 1, j + 1);
+                int tris[6] = { a, c, b, b, c, d };
+                cloth_triangles.insert(cloth_triangles.end(), tris, tris + 6);
+            }
+        }
+        cloth_bvh.build(p.x.data(), p.y.data(), p.z.data(), 1,
+            cloth_triangles.data(), (int)cloth_triangles.size() / 3);
+    }
+
+    for (const std::unique_ptr<Collider>& c : colliders)
+        push_particles(*c);
+    cloth_bvh.update();
+    for (const std::unique_ptr<Collider>& c : colliders)
+        push_cloth(*c);
+}
+
+// Every particle only moves itself, so the particles are split between
+// threads. The side of the surface a particle belongs on is the side it was
+// on at the start of the substep, which also catches particles that went
+// right through a triangle.
+void ClothSolver::push_particles(const Collider& c) {
+    const std::vector<float>& prev_x = xpbd_solver.previous_x();
+    const std::vector<float>& prev_y = xpbd_solver.previous_y();
+    const std::vector<float>& prev_z = xpbd_solver.previous_z();
+    const float t2 = thickness * thickness;
+
+    parallel_for(jobs, p.size(), 256, [&](int begin, int end) {
+        for (int i = begin; i < end; ++i) {
+            if (p.inv_mass[i] == 0.0f)
+                continue;
+            float pos[3] = { p.x[i], p.y[i], p.z[i] };
+            float prev[3] = { prev_x[i], prev_y[i], prev_z[i] };
+            float mx = pos[0] - prev[0], my = pos[1] - prev[1], mz = pos[2] - prev[2];
+            float reach = thickness + sqrtf(mx * mx + my * my + mz * mz);
+
+            BvhHit hit;
+            if (!c.bvh.closest(pos, reach, hit))
+                continue;
+            float n[3];
+            triangle_normal(c.bvh, hit.triangle, n);
+            float side = (prev[0] - hit.point[0]) * n[0] + (prev[1] - hit.point[1]) * n[1]
+                + (prev[2] - hit.point[2]) * n[2] >= 0.0f ? 1.0f : -1.0f;
+            float dist = side * ((pos[0] - hit.point[0]) * n[0] + (pos[1] - hit.point[1]) * n[1]
+                + (pos[2] - hit.point[2]) * n[2]);
+            if (dist >= thickness || (dist >= 0.0f && hit.dist2 >= t2))
+                continue;
+
+            float push = side * (thickness - dist);
+            p.x[i] += n[0] * push;
+            p.y[i] += n[1] * push;
+            p.z[i] += n[2] * push;
+        }
+    });
+}
+
+// A collider vertex closer than thickness to a cloth triangle pushes the
+// three corners apart by their barycentric weights, like a distance
+// constraint between the vertex and the point on the triangle. The tree
+// queries run on all threads and only record the triangles; the pushes are
+// applied in vertex order afterwards, measured again on the moved cloth.
+void ClothSolver::push_cloth(const Collider& c) {
+    float lo[3], hi[3];
+    cloth_bvh.bounds(lo, hi);
+    const int count = (int)c.vertices.size() / 3;
+    touching.resize(count);
+    parallel_for(jobs, count, 1024, [&](int begin, int end) {
+        for (int v = begin; v < end; ++v) {
+            const float* q = &c.vertices[3 * (size_t)v];
+            touching[v] = -1;
+            if (q[0] < lo[0] - thickness || q[0] > hi[0] + thickness ||
+                q[1] < lo[1] - thickness || q[1] > hi[1] + thickness ||
+                q[2] < lo[2] - thickness || q[2] > hi[2] + thickness)
+                continue;
+            BvhHit hit;
+            if (cloth_bvh.closest(q, thickness, hit))
+                touching[v] = hit.triangle;
+        }
+    });
+
+    for (int v = 0; v < count; ++v) {
+        if (touching[v] < 0)
+            continue;
+        const float* q = &c.vertices[3 * (size_t)v];
+        const int* corner = cloth_bvh.triangle(touching[v]);
+        float a[3], b[3], e[3], point[3], bary[3];
+        cloth_bvh.vertex(corner[0], a);
+        cloth_bvh.vertex(corner[1], b);
+        cloth_bvh.vertex(corner[2], e);
+        closest_point_on_triangle(q, a, b, e, point, bary);
+        float dx = point[0] - q[0], dy = point[1] - q[1], dz = point[2] - q[2];
+        float d2 = dx * dx + dy * dy + dz * dz;
+        if (d2 >= thickness * thickness || d2 < 1e-18f)
+            continue;
+
+        float wsum = 0.0f;
+        for (int k = 0; k < 3; ++k)
+            wsum += p.inv_mass[corner[k]] * bary[k] * bary[k];
+        if (wsum == 0.0f)
+            continue;
+        float d = sqrtf(d2);
+        float s = (thickness - d) / (d * wsum);
+        for (int k = 0; k < 3; ++k) {
+            float f = p.inv_mass[corner[k]] * bary[k] * s;
+            p.x[corner[k]] += f * dx;
+            p.y[corner[k]] += f * dy;
+            p.z[corner[k]] += f * dz;
+        }
+    }
+}
@@ -0,0 +1,117 @@
+#ifndef CLOTH_SOLVER_H
+#define CLOTH_SOLVER_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "bvh.h"
+#include "job_system.h"
+#include "xpbd_solver.h"
+#include "implicit_solver.h"
+
+// Particles of a rows x cols cloth grid kept as structure of arrays.
+// Particle (row, col) lives at index row * cols + col in every array,
+// so a whole row is contiguous in memory.
+struct ClothParticles {
+    int rows = 0;
+    int cols = 0;
+    std::vector<float> x, y, z;
+    std::vector<float> vx, vy, vz;
+    std::vector<float> inv_mass;    // 0 means the particle is pinned
+
+    void resize(int rows, int cols);
+
+    int size() const { return rows * cols; }
+    int index(int row, int col) const { return row * cols + col; }
+};
+
+// Headless cloth simulation: owns the particle grid and advances it in time.
+// Nothing here touches OpenGL, so it can run on machines without a display.
+class ClothSolver {
+public:
+    enum Method {
+        EXPLICIT,       // free particles, no constraints between them
+        XPBD,           // position based constraints, see XpbdSolver
+        IMPLICIT        // backward Euler springs, see ImplicitSolver
+    };
+
+    // Lays the grid out in the XY plane: row 0 at origin_y, every next row
+    // `spacing` lower, columns going to the right from origin_x.
+    ClothSolver(int rows, int cols, float spacing,
+        float origin_x = 0.0f, float origin_y = 0.0f, float origin_z = 0.0f);
+
+    // Advances the simulation by dt seconds.
+    void step(float dt);
+
+    void set_gravity(float gx, float gy, float gz);
+    void set_wind(float wx, float wy, float wz);    // acceleration, like gravity
+    void set_damping(float damping);
+    void set_method(Method method);
+    Method get_method() const { return method; }
+
+    // Job system for the explicit and XPBD steps and for compute_normals,
+    // e.g. &shared_jobs(). NULL, the default, keeps everything on the
+    // calling thread.
+    void set_jobs(JobSystem* jobs) { this->jobs = jobs; }
+    JobSystem* get_jobs() const { return jobs; }
+
+    void set_velocity(int row, int col, float vx, float vy, float vz);
+    void pin(int row, int col);
+
+    // Triangle meshes the cloth collides with, used by the XPBD method.
+    // Vertices are interleaved x, y, z in world space and triangles are
+    // three vertex indices each; both are copied. Returns the collider id.
+    int add_collider(const float* vertices, int vertex_count, const int* triangles, int triangle_count);
+    // New vertex positions for a moving or deforming collider, same count
+    // and order as before. Its tree is refitted, not rebuilt.
+    void move_collider(int id, const float* vertices);
+    void remove_colliders();
+    // Distance kept between the cloth and the colliders.
+    void set_thickness(float thickness);
+    float get_thickness() const { return thickness; }
+
+    // Unit surface normal of every particle, interleaved x, y, z in particle
+    // order, ready to upload next to the positions. Rows are independent and
+    // are split between the threads of the job system.
+    void compute_normals(std::vector<float>& normals) const;
+
+    int rows() const { return p.rows; }
+    int cols() const { return p.cols; }
+    int size() const { return p.size(); }
+    float get_spacing() const { return spacing; }
+
+    ClothParticles& particles() { return p; }
+    const ClothParticles& particles() const { return p; }
+
+    XpbdSolver& xpbd() { return xpbd_solver; }
+    ImplicitSolver& implicit() { return implicit_solver; }
+
+private:
+    struct Collider {
+        std::vector<float> vertices;
+        TriangleBvh bvh;
+    };
+
+    void integrate(float dt);
+    void apply_drag(float dt);
+    void collide_meshes();
+    void push_particles(const Collider& c);
+    void push_cloth(const Collider& c);
+
+    ClothParticles p;
+    XpbdSolver xpbd_solver;
+    ImplicitSolver implicit_solver;
+    JobSystem* jobs;
+    Method method;
+    float spacing;
+    float gravity[3];
+    float wind[3];
+    float damping;      // linear drag, fraction of velocity lost per second
+    float thickness;
+    std::vector<std::unique_ptr<Collider>> colliders;
+    std::vector<int> cloth_triangles;
+    TriangleBvh cloth_bvh;  // over cloth_triangles, refitted every substep
+    std::vector<int> touching;  // scratch for push_cloth
+};
+
+#endif
@@ -0,0 +1,483 @@
+#include "frame_capture.h"
+#include "profiler.h"
+#include <cctype>
+#include <cmath>
+#include <cstring>
+
+FrameCapture::FrameCapture() {
+    kind = PPM;
+    video = NULL;
+    video_next = 0;
+    width = 0;
+    height = 0;
+    interval = 0;
+    next_time = 0;
+    captured_count = 0;
+    head = 0;
+    tail = 0;
+    max_queued = 0;
+    written_count = 0;
+    dropped_count = 0;
+    failed_count = 0;
+    repeated_count = 0;
+    quit = false;
+}
+
+FrameCapture::~FrameCapture() {
+    close();
+}
+
+static bool ends_with(const std::string& s, const char* suffix) {
+    const size_t n = strlen(suffix);
+    if (s.size() < n)
+        return false;
+    for (size_t i = 0; i < n; ++i)
+        if (tolower((unsigned char)s[s.size() - n + i]) != suffix[i])
+            return false;
+    return true;
+}
+
+// Conversions in a file name pattern, or -1 if one of them is not an int
+// one like %d or %05d: the pattern is used as a printf format for the
+// frame number. %% is text.
+static int int_conversions(const std::string& pattern) {
+    int count = 0;
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        if (pattern[i] != '%')
+            continue;
+        if (++i < pattern.size() && pattern[i] == '%')
+            continue;
+        while (i < pattern.size() && strchr("-+ #0", pattern[i]))
+            ++i;
+        while (i < pattern.size() && isdigit((unsigned char)pattern[i]))
+            ++i;
+        if (i == pattern.size() || (pattern[i] != 'd' && pattern[i] != 'i'))
+            return -1;
+        ++count;
+    }
+    return count;
+}
+
+bool FrameCapture::open(const char* path, int width, int height, double fps, int threads) {
+    close();
+    pattern = path;
+    if (ends_with(pattern, ".y4m"))
+        kind = Y4M;
+    else if (ends_with(pattern, ".png"))
+        kind = PNG;
+    else if (ends_with(pattern, ".ppm"))
+        kind = PPM;
+    else
+        return false;
+    if (width <= 0 || height <= 0 || fps <= 0)
+        return false;
+
+    this->width = width;
+    this->height = height;
+    interval = 1.0 / fps;
+    next_time = 0;
+    captured_count = 0;
+    written_count = 0;
+    dropped_count = 0;
+    failed_count = 0;
+    repeated_count = 0;
+    quit = false;
+    video_last.clear();
+    video_next = 0;
+
+    if (kind == Y4M) {
+        video = fopen(path, "wb");
+        if (!video)
+            return false;
+        // C420jpeg: full range BT.601, chroma at the centre of each 2x2 block
+        int num = (int)lround(fps * 1000.0), den = 1000;
+        if (fabs(fps - lround(fps)) < 1e-9) {
+            num = (int)lround(fps);
+            den = 1;
+        }
+        fprintf(video, "YUV4MPEG2 W%d H%d F%d:%d Ip A1:1 C420jpeg\n", width, height, num, den);
+        threads = 1;                // frames of a stream go out in order
+    } else {
+        int conversions = int_conversions(pattern);
+        if (conversions == 0)
+            pattern.insert(pattern.size() - 4, "_%05d");
+        else if (conversions != 1)
+            return false;
+    }
+    if (threads < 1)
+        threads = 1;
+
+    const int ring = 3;
+    pbos.assign(ring, 0);
+    fences.assign(ring, (GLsync)0);
+    frame_index.assign(ring, 0);
+    head = 0;
+    tail = 0;
+    glGenBuffers(ring, pbos.data());
+    for (int i = 0; i < ring; ++i) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[i]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)width * height * 4, NULL, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    max_queued = 2 * threads + 2;
+    for (int i = 0; i < threads; ++i)
+        this->threads.push_back(std::thread(&FrameCapture::worker, this));
+    return true;
+}
+
+void FrameCapture::close() {
+    if (!pbos.empty()) {
+        while (fences[tail])
+            collect(true, true);
+        glDeleteBuffers((GLsizei)pbos.size(), pbos.data());
+        pbos.clear();
+        fences.clear();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    wake.notify_all();
+    for (std::thread& t : threads)
+        t.join();
+    threads.clear();
+    // frames dropped after the last one written still take their time
+    if (video)
+        repeat_video(captured_count);
+    for (Frame* f : queue)
+        delete f;
+    queue.clear();
+    for (Frame* f : spare)
+        delete f;
+    spare.clear();
+    if (video)
+        fclose(video);
+    video = NULL;
+}
+
+void FrameCapture::frame(GLuint fbo, double time, int fb_width, int fb_height) {
+    if (pbos.empty())
+        return;
+    collect(false);
+    if (time < next_time)
+        return;
+    next_time = (floor(time / interval) + 1.0) * interval;
+    if (fb_width < width || fb_height < height) {
+        // reading the capture size would go past the framebuffer
+        ++captured_count;
+        std::lock_guard<std::mutex> lock(mutex);
+        ++dropped_count;
+        return;
+    }
+
+    // the GPU is a whole ring of captures behind: wait for the oldest
+    if (fences[head])
+        collect(true);
+
+    PROFILE_ZONE("capture_read");
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[head]);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    fences[head] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    frame_index[head] = captured_count++;
+    head = (head + 1) % (int)pbos.size();
+}
+
+// Hands the readbacks whose fences have signalled to the writers, oldest
+// first; with wait, the oldest one is waited for. A frame that finds the
+// queue full is dropped, or with keep waits for room in it.
+void FrameCapture::collect(bool wait, bool keep) {
+    while (fences[tail]) {
+        GLsync sync = fences[tail];
+        GLenum status = glClientWaitSync(sync, 0, 0);
+        if (status == GL_TIMEOUT_EXPIRED && wait) {
+            do
+                status = glClientWaitSync(sync, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);   // 1 ms
+            while (status == GL_TIMEOUT_EXPIRED);
+        }
+        if (status == GL_TIMEOUT_EXPIRED)
+            return;
+        wait = false;
+        glDeleteSync(sync);
+        fences[tail] = 0;
+
+        Frame* f = NULL;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (keep)
+                room.wait(lock, [this] { return (int)queue.size() < max_queued; });
+            if ((int)queue.size() < max_queued) {
+                if (spare.empty()) {
+                    f = new Frame;
+                } else {
+                    f = spare.back();
+                    spare.pop_back();
+                }
+            } else {
+                ++dropped_count;
+            }
+        }
+        if (f) {
+            PROFILE_ZONE("capture_copy");
+            f->index = frame_index[tail];
+            f->rgba.resize((size_t)width * height * 4);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[tail]);
+            const void* pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)f->rgba.size(), GL_MAP_READ_BIT);
+            if (pixels)
+                memcpy(f->rgba.data(), pixels, f->rgba.size());
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+            if (pixels) {
+                queue_frame(f);
+            } else {
+                std::lock_guard<std::mutex> lock(mutex);
+                ++failed_count;
+                spare.push_back(f);
+            }
+        }
+        tail = (tail + 1) % (int)pbos.size();
+    }
+}
+
+void FrameCapture::queue_frame(Frame* f) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push_back(f);
+    }
+    wake.notify_one();
+}
+
+void FrameCapture::worker() {
+    std::vector<unsigned char> scratch, encoded;
+    for (;;) {
+        Frame* f;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return quit || !queue.empty(); });
+            if (queue.empty())
+                return;
+            f = queue.front();
+            queue.pop_front();
+        }
+        room.notify_one();
+        bool ok;
+        {
+            PROFILE_ZONE("capture_write");
+            ok = write(*f, scratch, encoded);
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        if (ok)
+            ++written_count;
+        else
+            ++failed_count;
+        spare.push_back(f);
+    }
+}
+
+int FrameCapture::written() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return written_count;
+}
+
+int FrameCapture::dropped() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return dropped_count;
+}
+
+int FrameCapture::failed() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return failed_count;
+}
+
+int FrameCapture::repeated() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return repeated_count;
+}
+
+// RGB rows top first, as image files want them.
+static void flip_rgb(const std::vector<unsigned char>& rgba, int width, int height, unsigned char* rgb, int stride) {
+    for (int y = 0; y < height; ++y) {
+        const unsigned char* src = rgba.data() + (size_t)(height - 1 - y) * width * 4;
+        unsigned char* dst = rgb + (size_t)y * stride;
+        for (int x = 0; x < width; ++x) {
+            dst[3 * x] = src[4 * x];
+            dst[3 * x + 1] = src[4 * x + 1];
+            dst[3 * x + 2] = src[4 * x + 2];
+        }
+    }
+}
+
+static unsigned crc_table[256];
+
+static unsigned crc32(unsigned crc, const unsigned char* p, size_t n) {
+    static std::once_flag once;
+    std::call_once(once, [] {
+        for (unsigned i = 0; i < 256; ++i) {
+            unsigned c = i;
+            for (int k = 0; k < 8; ++k)
+                c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            crc_table[i] = c;
+        }
+    });
+    crc = ~crc;
+    for (size_t i = 0; i < n; ++i)
+        crc = crc_table[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+static void put32(unsigned char* p, unsigned v) {
+    p[0] = (unsigned char)(v >> 24);
+    p[1] = (unsigned char)(v >> 16);
+    p[2] = (unsigned char)(v >> 8);
+    p[3] = (unsigned char)v;
+}
+
+static bool write_chunk(FILE* f, const char* type, const unsigned char* data, size_t n) {
+    unsigned char head[8];
+    put32(head, (unsigned)n);
+    memcpy(head + 4, type, 4);
+    unsigned char tail[4];
+    put32(tail, crc32(crc32(0, head + 4, 4), data, n));
+    return fwrite(head, 1, 8, f) == 8 && (n == 0 || fwrite(data, 1, n, f) == n) && fwrite(tail, 1, 4, f) == 4;
+}
+
+// 8-bit RGB PNG whose zlib stream holds stored (uncompressed) deflate
+// blocks: no compression library, and no time spent compressing.
+static bool write_png(FILE* f, const unsigned char* rows, int width, int height, std::vector<unsigned char>& idat) {
+    static const unsigned char signature[8] = { 137, 'P', 'N', 'G', 13, 10, 26, 10 };
+    unsigned char ihdr[13];
+    put32(ihdr, (unsigned)width);
+    put32(ihdr + 4, (unsigned)height);
+    ihdr[8] = 8;        // bits per channel
+    ihdr[9] = 2;        // RGB
+    ihdr[10] = ihdr[11] = ihdr[12] = 0;
+
+    const size_t raw = (size_t)height * (1 + 3 * (size_t)width);     // filter byte per row
+    const size_t blocks = raw / 65535 + 1;
+    idat.resize(2 + raw + 5 * blocks + 4);
+    unsigned char* out = idat.data();
+    *out++ = 0x78;      // deflate, 32K window
+    *out++ = 0x01;
+    unsigned a = 1, b = 0;      // Adler-32
+    size_t left = raw, row_pos = 0;
+    int y = 0;
+    while (true) {
+        const unsigned len = (unsigned)(left < 65535 ? left : 65535);
+        left -= len;
+        *out++ = left == 0 ? 1 : 0;
+        out[0] = (unsigned char)len;
+        out[1] = (unsigned char)(len >> 8);
+        out[2] = (unsigned char)~len;
+        out[3] = (unsigned char)(~len >> 8);
+        out += 4;
+        for (unsigned i = 0; i < len; ++i) {
+            // filter type 0 in front of every row
+            const unsigned char c = row_pos == 0 ? 0 : rows[(size_t)y * 3 * width + row_pos - 1];
+            if (++row_pos == 1 + 3 * (size_t)width) {
+                row_pos = 0;
+                ++y;
+            }
+            *out++ = c;
+            a = (a + c) % 65521;
+            b = (b + a) % 65521;
+        }
+        if (left == 0)
+            break;
+    }
+    put32(out, (b << 16) | a);
+    out += 4;
+    idat.resize(out - idat.data());
+
+    return fwrite(signature, 1, 8, f) == 8 && write_chunk(f, "IHDR", ihdr, 13)
+        && write_chunk(f, "IDAT", idat.data(), idat.size()) && write_chunk(f, "IEND", NULL, 0);
+}
+
+// Full range BT.601 in 8.8 fixed point; chroma of the average of each 2x2
+// block, so the planes are (width + 1) / 2 x (height + 1) / 2.
+static void to_yuv420(const std::vector<unsigned char>& rgba, int width, int height, unsigned char* yuv) {
+    const int cw = (width + 1) / 2, ch = (height + 1) / 2;
+    unsigned char* py = yuv;
+    unsigned char* pu = yuv + (size_t)width * height;
+    unsigned char* pv = pu + (size_t)cw * ch;
+    for (int y = 0; y < height; ++y) {
+        const unsigned char* src = rgba.data() + (size_t)(height - 1 - y) * width * 4;
+        for (int x = 0; x < width; ++x)
+            py[(size_t)y * width + x] = (unsigned char)((77 * src[4 * x] + 150 * src[4 * x + 1] + 29 * src[4 * x + 2] + 128) >> 8);
+    }
+    for (int cy = 0; cy < ch; ++cy) {
+        for (int cx = 0; cx < cw; ++cx) {
+            int r = 0, g = 0, b = 0, n = 0;
+            for (int dy = 0; dy < 2; ++dy) {
+                const int y = 2 * cy + dy;
+                if (y >= height)
+                    continue;
+                for (int dx = 0; dx < 2; ++dx) {
+                    const int x = 2 * cx + dx;
+                    if (x >= width)
+                        continue;
+                    const unsigned char* p = rgba.data() + ((size_t)(height - 1 - y) * width + x) * 4;
+                    r += p[0];
+                    g += p[1];
+                    b += p[2];
+                    ++n;
+                }
+            }
+            r /= n;
+            g /= n;
+            b /= n;
+            // + 32768 is the offset of 128 in 8.8 and keeps the sums
+            // positive for the shift; pure blue or red comes out at 256
+            const int u = (-43 * r - 85 * g + 128 * b + 32768 + 128) >> 8;
+            const int v = (128 * r - 107 * g - 21 * b + 32768 + 128) >> 8;
+            pu[(size_t)cy * cw + cx] = (unsigned char)(u < 255 ? u : 255);
+            pv[(size_t)cy * cw + cx] = (unsigned char)(v < 255 ? v : 255);
+        }
+    }
+}
+
+bool FrameCapture::write(Frame& f, std::vector<unsigned char>& scratch, std::vector<unsigned char>& encoded) {
+    if (kind == Y4M) {
+        bool ok = repeat_video(f.index);
+        video_last.resize((size_t)width * height + 2 * (size_t)((width + 1) / 2) * ((height + 1) / 2));
+        to_yuv420(f.rgba, width, height, video_last.data());
+        ok = repeat_video(f.index) && ok;     // no earlier frame: this one fills in
+        video_next = f.index + 1;
+        return write_video(video_last) && ok;
+    }
+
+    char path[1024];
+    snprintf(path, sizeof(path), pattern.c_str(), f.index);
+    FILE* out = fopen(path, "wb");
+    if (!out)
+        return false;
+    const size_t rgb_size = (size_t)width * height * 3;
+    scratch.resize(rgb_size);
+    flip_rgb(f.rgba, width, height, scratch.data(), 3 * width);
+    bool ok;
+    if (kind == PPM) {
+        ok = fprintf(out, "P6\n%d %d\n255\n", width, height) > 0 && fwrite(scratch.data(), 1, rgb_size, out) == rgb_size;
+    } else {
+        ok = write_png(out, scratch.data(), width, height, encoded);
+    }
+    return fclose(out) == 0 && ok;
+}
+
+bool FrameCapture::write_video(const std::vector<unsigned char>& yuv) {
+    return fwrite("FRAME\n", 1, 6, video) == 6 && fwrite(yuv.data(), 1, yuv.size(), video) == yuv.size();
+}
+
+// Writes the last video frame again for every frame before index that was
+// dropped or failed, so the stream keeps its frame rate. Only the video
+// writer thread, or close() once it is gone, calls this.
+bool FrameCapture::repeat_video(int index) {
+    bool ok = true;
+    for (; video_next < index && !video_last.empty(); ++video_next) {
+        ok = write_video(video_last) && ok;
+        std::lock_guard<std::mutex> lock(mutex);
+        ++repeated_count;
+    }
+    return ok;
+}
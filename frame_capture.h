@@ -0,0 +1,117 @@
+#ifndef FRAME_CAPTURE_H
+#define FRAME_CAPTURE_H
+
+#include <glad/glad.h>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Records rendered frames to disk without stalling the render loop:
+//
+//     FrameCapture capture;
+//     capture.open("frames/cloth_%05d.png", width, height, 30.0);
+//     while (...) {
+//         draw();
+//         capture.frame(context.resolve(), context.time(), w, h);    // before swap
+//         context.swap();
+//     }
+//     capture.close();
+//
+// The path picks the format by its extension: .y4m writes one raw YUV
+// 4:2:0 video stream, .ppm and .png one file per frame named with the
+// printf pattern in the path: one int conversion such as %05d, which is
+// added before the extension if there is none; open() fails on any other
+// conversion. PNGs are stored without compression to stay free of zlib.
+//
+// frame() takes a frame whenever the time has reached the next multiple of
+// 1 / fps, so the capture rate is independent of the frame and simulation
+// rates; a loop slower than that skips slots rather than repeating frames.
+// glReadPixels goes into a ring of pixel buffer objects with a fence each
+// and returns at once; a later frame() finds the fence signalled, copies
+// the pixels out and queues them for the writer threads, which flip,
+// convert, encode and write. The render thread only waits for the GPU,
+// when it is a whole ring of captures behind, never for the disk: when the
+// writers fall behind by more than a few frames, new frames are dropped.
+// Dropped frames leave gaps in the numbers of a sequence; a video has a
+// fixed frame rate, so there the last written frame is repeated instead.
+class FrameCapture {
+public:
+    enum Format { PPM, PNG, Y4M };
+
+    FrameCapture();
+    ~FrameCapture();
+
+    FrameCapture(const FrameCapture&) = delete;
+    FrameCapture& operator=(const FrameCapture&) = delete;
+
+    // Needs a current GL 3.3 context. False if the extension is not one of
+    // the above or the video file cannot be created. A video is written by
+    // one thread, sequences by `threads`.
+    bool open(const char* path, int width, int height, double fps, int threads = 2);
+    // Waits for all captures to be read back and written; needs the context.
+    void close();
+    bool is_open() const { return !pbos.empty(); }
+
+    // Captures the lower left width x height pixels of framebuffer fbo (0
+    // for the window), which is fb_width x fb_height now, if a frame is due
+    // at time, in seconds. A framebuffer resized below the capture size
+    // drops the frame instead. Leaves fbo bound as the read framebuffer.
+    void frame(GLuint fbo, double time, int fb_width, int fb_height);
+
+    Format format() const { return kind; }
+    int captured() const { return captured_count; }
+    int written() const;
+    int dropped() const;
+    int failed() const;             // frames that could not be written
+    int repeated() const;           // video frames written again for dropped ones
+
+private:
+    struct Frame {
+        int index;
+        std::vector<unsigned char> rgba;    // bottom row first, as GL reads
+    };
+
+    void collect(bool wait, bool keep = false);
+    void queue_frame(Frame* f);
+    void worker();
+    bool write(Frame& f, std::vector<unsigned char>& scratch, std::vector<unsigned char>& encoded);
+    bool write_video(const std::vector<unsigned char>& yuv);
+    bool repeat_video(int index);
+
+    Format kind;
+    std::string pattern;
+    FILE* video;
+    std::vector<unsigned char> video_last;  // YUV planes of the last video frame
+    int video_next;                 // index of the next video frame
+    int width;
+    int height;
+    double interval;
+    double next_time;
+    int captured_count;
+
+    // ring of readbacks; fences[i] is 0 when pbos[i] is free
+    std::vector<GLuint> pbos;
+    std::vector<GLsync> fences;
+    std::vector<int> frame_index;
+    int head;                       // next PBO to read into
+    int tail;                       // oldest readback in flight
+
+    std::vector<std::thread> threads;
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable room;   // a frame left the queue
+    std::deque<Frame*> queue;
+    std::vector<Frame*> spare;      // finished frames, reused
+    int max_queued;
+    int written_count;
+    int dropped_count;
+    int failed_count;
+    int repeated_count;
+    bool quit;
+};
+
+#endif
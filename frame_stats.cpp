@@ -0,0 +1,44 @@
+#include "frame_stats.h"
+#include <algorithm>
+
+FrameStats::FrameStats(int window) {
+    samples.assign(window > 0 ? window : 1, 0.0);
+    next = 0;
+    filled = 0;
+}
+
+void FrameStats::add(double seconds) {
+    samples[next] = seconds;
+    next = (next + 1) % (int)samples.size();
+    if (filled < (int)samples.size())
+        ++filled;
+}
+
+void FrameStats::clear() {
+    next = 0;
+    filled = 0;
+}
+
+double FrameStats::mean() const {
+    if (filled == 0)
+        return 0.0;
+    double sum = 0.0;
+    for (int i = 0; i < filled; ++i)
+        sum += samples[i];
+    return sum / filled;
+}
+
+double FrameStats::percentile(double p) const {
+    if (filled == 0)
+        return 0.0;
+    std::vector<double> sorted(samples.begin(), samples.begin() + filled);
+    const int k = std::min(filled - 1, std::max(0, (int)(p * filled)));
+    std::nth_element(sorted.begin(), sorted.begin() + k, sorted.end());
+    return sorted[k];
+}
+
+void FrameStats::print(FILE* out, const char* name) const {
+    // one fprintf, so lines of two threads do not mix
+    fprintf(out, "%s: %d, mean %.2f ms, p50 %.2f ms, p99 %.2f ms, max %.2f ms\n", name, filled,
+        mean() * 1e3, percentile(0.5) * 1e3, percentile(0.99) * 1e3, percentile(1.0) * 1e3);
+}
@@ -0,0 +1,38 @@
+#ifndef FRAME_STATS_H
+#define FRAME_STATS_H
+
+#include <cstdio>
+#include <vector>
+
+// Durations of the last `window` frames or steps of one thread, e.g. the
+// time between two frames of the render thread or the cost of each step
+// of the simulation thread:
+//
+//     FrameStats stats;
+//     ...
+//     stats.add(seconds);
+//     stats.print(stdout, "render frame");
+//
+// Not shared between threads: each keeps its own.
+class FrameStats {
+public:
+    explicit FrameStats(int window = 300);
+
+    void add(double seconds);
+    void clear();
+
+    int count() const { return filled; }
+    double mean() const;
+    // p in [0, 1]: 0.5 the median, 1 the longest.
+    double percentile(double p) const;
+
+    // One line: count, mean, median, 99th percentile and maximum in ms.
+    void print(FILE* out, const char* name) const;
+
+private:
+    std::vector<double> samples;    // ring of the last window durations
+    int next;
+    int filled;
+};
+
+#endif
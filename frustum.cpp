@@ -0,0 +1,168 @@
+#include "frustum.h"
+#include "simd_kernels.h"
+#include <algorithm>
+#include <cmath>
+
+// The plane tests below must round like the vector code, so a multiply and
+// an add are never fused into one FMA.
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#elif defined(_MSC_VER)
+#pragma fp_contract(off)
+#endif
+
+void Frustum::extract(const float* m) {
+    // rows of the matrix; element (row, col) is m[col * 4 + row]
+    for (int p = 0; p < 6; ++p) {
+        const int row = p / 2;
+        const float sign = p % 2 == 0 ? 1.0f : -1.0f;   // left/right, bottom/top, near/far
+        float pa = m[3] + sign * m[row];
+        float pb = m[7] + sign * m[4 + row];
+        float pc = m[11] + sign * m[8 + row];
+        float pd = m[15] + sign * m[12 + row];
+        const float len = sqrtf(pa * pa + pb * pb + pc * pc);
+        const float inv = len > 0 ? 1.0f / len : 0.0f;
+        a[p] = pa * inv;
+        b[p] = pb * inv;
+        c[p] = pc * inv;
+        d[p] = pd * inv;
+    }
+}
+
+bool Frustum::sphere_visible(float x, float y, float z, float r) const {
+    for (int p = 0; p < 6; ++p) {
+        // summed in the same order as the vector code, so both agree exactly
+        if ((a[p] * x + b[p] * y) + (c[p] * z + d[p]) < -r)
+            return false;
+    }
+    return true;
+}
+
+static int cull_scalar(const Frustum& f, const float* x, const float* y, const float* z,
+    const float* r, int begin, int end, int* visible) {
+    int n = 0;
+    for (int i = begin; i < end; ++i) {
+        if (f.sphere_visible(x[i], y[i], z[i], r[i]))
+            visible[n++] = i;
+    }
+    return n;
+}
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+
+#include <immintrin.h>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define SIMD_TARGET(isa)
+static inline int lowest_bit(unsigned v) {
+    unsigned long k;
+    _BitScanForward(&k, v);
+    return (int)k;
+}
+#else
+#define SIMD_TARGET(isa) __attribute__((target(isa)))
+static inline int lowest_bit(unsigned v) {
+    return __builtin_ctz(v);
+}
+#endif
+
+// 4 spheres per instruction; a sphere is out as soon as one plane has it
+// entirely on the outside.
+SIMD_TARGET("sse4.2")
+static int cull_sse42(const Frustum& f, const float* x, const float* y, const float* z,
+    const float* r, int count, int* visible) {
+    int n = 0;
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128 vx = _mm_loadu_ps(x + i);
+        const __m128 vy = _mm_loadu_ps(y + i);
+        const __m128 vz = _mm_loadu_ps(z + i);
+        const __m128 neg_r = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(r + i));
+        __m128 out = _mm_setzero_ps();
+        for (int p = 0; p < 6; ++p) {
+            __m128 dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(f.a[p]), vx),
+                _mm_mul_ps(_mm_set1_ps(f.b[p]), vy)),
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(f.c[p]), vz), _mm_set1_ps(f.d[p])));
+            out = _mm_or_ps(out, _mm_cmplt_ps(dist, neg_r));
+        }
+        int in = ~_mm_movemask_ps(out) & 0xF;
+        while (in) {
+            int k = lowest_bit((unsigned)in);
+            visible[n++] = i + k;
+            in &= in - 1;
+        }
+    }
+    return n + cull_scalar(f, x, y, z, r, i, count, visible + n);
+}
+
+SIMD_TARGET("avx2")
+static int cull_avx2(const Frustum& f, const float* x, const float* y, const float* z,
+    const float* r, int count, int* visible) {
+    int n = 0;
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256 vx = _mm256_loadu_ps(x + i);
+        const __m256 vy = _mm256_loadu_ps(y + i);
+        const __m256 vz = _mm256_loadu_ps(z + i);
+        const __m256 neg_r = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(r + i));
+        __m256 out = _mm256_setzero_ps();
+        for (int p = 0; p < 6; ++p) {
+            __m256 dist = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(f.a[p]), vx),
+                _mm256_mul_ps(_mm256_set1_ps(f.b[p]), vy)),
+                _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(f.c[p]), vz), _mm256_set1_ps(f.d[p])));
+            out = _mm256_or_ps(out, _mm256_cmp_ps(dist, neg_r, _CMP_LT_OQ));
+        }
+        int in = ~_mm256_movemask_ps(out) & 0xFF;
+        while (in) {
+            int k = lowest_bit((unsigned)in);
+            visible[n++] = i + k;
+            in &= in - 1;
+        }
+    }
+    return n + cull_scalar(f, x, y, z, r, i, count, visible + n);
+}
+
+#endif
+
+int cull_spheres(const Frustum& f, const float* x, const float* y, const float* z,
+    const float* r, int count, int* visible) {
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    // AVX-512 builds use the AVX2 path: 6 planes of 8 spheres already keep
+    // this far below the cost of drawing them
+    const SimdIsa isa = cloth_kernels().isa;
+    if (isa == ISA_AVX2 || isa == ISA_AVX512)
+        return cull_avx2(f, x, y, z, r, count, visible);
+    if (isa == ISA_SSE42)
+        return cull_sse42(f, x, y, z, r, count, visible);
+#endif
+    return cull_scalar(f, x, y, z, r, 0, count, visible);
+}
+
+void tile_bounds(const float* ax, const float* ay, const float* az,
+    const float* bx, const float* by, const float* bz, int count, int tile, float pad,
+    float* x, float* y, float* z, float* r) {
+    for (int t = 0, begin = 0; begin < count; ++t, begin += tile) {
+        const int end = std::min(begin + tile, count);
+        float lo[3] = { ax[begin], ay[begin], az[begin] };
+        float hi[3] = { lo[0], lo[1], lo[2] };
+        for (int i = begin; i < end; ++i) {
+            lo[0] = std::min(lo[0], std::min(ax[i], bx[i]));
+            lo[1] = std::min(lo[1], std::min(ay[i], by[i]));
+            lo[2] = std::min(lo[2], std::min(az[i], bz[i]));
+            hi[0] = std::max(hi[0], std::max(ax[i], bx[i]));
+            hi[1] = std::max(hi[1], std::max(ay[i], by[i]));
+            hi[2] = std::max(hi[2], std::max(az[i], bz[i]));
+        }
+        // sphere around the box: not the tightest, but one pass
+        const float ex = 0.5f * (hi[0] - lo[0]);
+        const float ey = 0.5f * (hi[1] - lo[1]);
+        const float ez = 0.5f * (hi[2] - lo[2]);
+        x[t] = lo[0] + ex;
+        y[t] = lo[1] + ey;
+        z[t] = lo[2] + ez;
+        r[t] = sqrtf(ex * ex + ey * ey + ez * ez) + pad;
+    }
+}
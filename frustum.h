@@ -0,0 +1,38 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+// The six planes of a view frustum, each a * x + b * y + c * z + d = 0 with
+// the inside positive and (a, b, c) of unit length, so plugging a point in
+// gives its signed distance to the plane. Planes are stored as structure of
+// arrays like ClothParticles.
+struct Frustum {
+    float a[6], b[6], c[6], d[6];
+
+    // Planes of the clip matrix m (projection * view, times model for
+    // object space), column-major as glm and glUniformMatrix4fv(..., GL_FALSE,
+    // ...) use it. The identity gives the -1..1 cube of clip space.
+    void extract(const float* m);
+
+    // False only if the sphere lies entirely outside one of the planes. Near
+    // the frustum corners a sphere outside of it can still pass; culling
+    // only has to be conservative.
+    bool sphere_visible(float x, float y, float z, float r) const;
+};
+
+// Writes the indices of the spheres (centres x, y, z, radii r) that may be
+// visible to `visible` in increasing order and returns how many there are.
+// Spheres are tested 4 or 8 at a time with the instruction set
+// cloth_kernels() picked, so CLOTH_SIMD caps it here too.
+int cull_spheres(const Frustum& f, const float* x, const float* y, const float* z,
+    const float* r, int count, int* visible);
+
+// Bounding spheres of consecutive groups of `tile` points (the last group
+// may be smaller), enclosing the points of both sets a and b, e.g. the last
+// two simulation steps so every position interpolated between them is
+// inside. pad is added to every radius for the size of what is drawn at a
+// point. Writes (count + tile - 1) / tile spheres.
+void tile_bounds(const float* ax, const float* ay, const float* az,
+    const float* bx, const float* by, const float* bz, int count, int tile, float pad,
+    float* x, float* y, float* z, float* r);
+
+#endif
@@ -0,0 +1,315 @@
+#include "gl_context.h"
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#ifdef CLOTH_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+#ifdef CLOTH_OSMESA
+#include <GL/osmesa.h>
+#endif
+
+GlContext::GlContext() {
+    kind = WINDOW;
+    win = NULL;
+    display = NULL;
+    context = NULL;
+    draw_fbo = 0;
+    resolve_fbo = 0;
+    renderbuffers[0] = renderbuffers[1] = renderbuffers[2] = 0;
+    width = 0;
+    height = 0;
+    frames = 0;
+    max_frames = 0;
+    resolved = false;
+}
+
+GlContext::~GlContext() {
+    destroy();
+}
+
+GlContext::Backend GlContext::requested() {
+    const char* value = getenv("CLOTH_HEADLESS");
+    if (!value || !*value || strcmp(value, "0") == 0)
+        return WINDOW;
+    if (strcmp(value, "egl") == 0)
+        return EGL;
+    if (strcmp(value, "osmesa") == 0)
+        return OSMESA;
+#if defined(CLOTH_EGL) || !defined(CLOTH_OSMESA)
+    return EGL;
+#else
+    return OSMESA;
+#endif
+}
+
+bool GlContext::create(int width, int height, const char* title, int samples, Backend backend) {
+    destroy();
+    kind = backend;
+    this->width = width;
+    this->height = height;
+    frames = 0;
+    resolved = false;
+    const char* frames_value = getenv("CLOTH_FRAMES");
+    max_frames = frames_value && atoi(frames_value) > 0 ? atoi(frames_value) : 600;
+
+    bool ok;
+    if (kind == WINDOW)
+        ok = create_window(title, samples);
+    else
+        ok = (kind == EGL ? create_egl() : create_osmesa()) && create_framebuffer(samples);
+    if (!ok)
+        destroy();
+    return ok;
+}
+
+bool GlContext::create_window(const char* title, int samples) {
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    if (samples > 0)
+        glfwWindowHint(GLFW_SAMPLES, samples);
+#ifdef __APPLE__
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+
+    win = glfwCreateWindow(width, height, title, NULL, NULL);
+    if (win == NULL) {
+        std::cout << "Failed to create GLFW window" << std::endl;
+        return false;
+    }
+    glfwMakeContextCurrent(win);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+#ifdef CLOTH_EGL
+static void* egl_proc_address(const char* name) {
+    return (void*)eglGetProcAddress(name);
+}
+#endif
+
+// Mesa's surfaceless platform needs neither a display server nor a GPU;
+// other EGLs get the default display. The context is made current without
+// any surface (EGL_KHR_surfaceless_context) and draws into our framebuffer.
+bool GlContext::create_egl() {
+#ifdef CLOTH_EGL
+    EGLDisplay dpy = EGL_NO_DISPLAY;
+    const char* client = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (client && strstr(client, "EGL_MESA_platform_surfaceless") && get_platform_display)
+        dpy = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    if (dpy == EGL_NO_DISPLAY)
+        dpy = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    EGLint major, minor;
+    if (dpy == EGL_NO_DISPLAY || !eglInitialize(dpy, &major, &minor)) {
+        std::cout << "Failed to initialize EGL" << std::endl;
+        return false;
+    }
+    display = dpy;
+    const char* extensions = eglQueryString(dpy, EGL_EXTENSIONS);
+    if (!extensions || !strstr(extensions, "EGL_KHR_surfaceless_context")) {
+        std::cout << "EGL has no surfaceless contexts" << std::endl;
+        return false;
+    }
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        std::cout << "EGL has no desktop OpenGL" << std::endl;
+        return false;
+    }
+
+    const EGLint config_attribs[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+    EGLConfig config = NULL;
+    EGLint configs = 0;
+    eglChooseConfig(dpy, config_attribs, &config, 1, &configs);
+    const EGLint context_attribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    // a config only matters for surfaces; without one any context will do
+    EGLContext ctx = eglCreateContext(dpy, configs > 0 ? config : (EGLConfig)0, EGL_NO_CONTEXT, context_attribs);
+    if (ctx == EGL_NO_CONTEXT) {
+        std::cout << "Failed to create EGL context, error 0x" << std::hex << eglGetError() << std::dec << std::endl;
+        return false;
+    }
+    context = ctx;
+    if (!eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx)) {
+        std::cout << "Failed to make the EGL context current" << std::endl;
+        return false;
+    }
+    if (!gladLoadGLLoader(egl_proc_address)) {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        return false;
+    }
+    return true;
+#else
+    std::cout << "Built without CLOTH_EGL, no EGL backend" << std::endl;
+    return false;
+#endif
+}
+
+#ifdef CLOTH_OSMESA
+static void* osmesa_proc_address(const char* name) {
+    return (void*)OSMesaGetProcAddress(name);
+}
+#endif
+
+// OSMesa renders on the CPU into memory of ours; the frames still go to
+// the framebuffer object so reading them back works like with EGL.
+bool GlContext::create_osmesa() {
+#ifdef CLOTH_OSMESA
+    const int attribs[] = {
+        OSMESA_FORMAT, OSMESA_RGBA,
+        OSMESA_DEPTH_BITS, 24,
+        OSMESA_STENCIL_BITS, 8,
+        OSMESA_PROFILE, OSMESA_CORE_PROFILE,
+        OSMESA_CONTEXT_MAJOR_VERSION, 3,
+        OSMESA_CONTEXT_MINOR_VERSION, 3,
+        0
+    };
+    OSMesaContext ctx = OSMesaCreateContextAttribs(attribs, NULL);
+    if (!ctx) {
+        std::cout << "Failed to create OSMesa context" << std::endl;
+        return false;
+    }
+    context = ctx;
+    osmesa_pixels.resize((size_t)width * height * 4);
+    if (!OSMesaMakeCurrent(ctx, osmesa_pixels.data(), GL_UNSIGNED_BYTE, width, height)) {
+        std::cout << "Failed to make the OSMesa context current" << std::endl;
+        return false;
+    }
+    if (!gladLoadGLLoader(osmesa_proc_address)) {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        return false;
+    }
+    return true;
+#else
+    std::cout << "Built without CLOTH_OSMESA, no OSMesa backend" << std::endl;
+    return false;
+#endif
+}
+
+// Color and depth-stencil renderbuffers of the window size, multisampled
+// if asked; those are resolved into a plain color buffer at every swap().
+bool GlContext::create_framebuffer(int samples) {
+    if (samples > 0) {
+        GLint max_samples = 0;
+        glGetIntegerv(GL_MAX_SAMPLES, &max_samples);
+        samples = samples < max_samples ? samples : max_samples;
+    }
+    glGenRenderbuffers(3, renderbuffers);
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_RGBA8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_DEPTH24_STENCIL8, width, height);
+    glGenFramebuffers(1, &draw_fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, draw_fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+
+    if (complete && samples > 0) {
+        glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[2]);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+        glGenFramebuffers(1, &resolve_fbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, resolve_fbo);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[2]);
+        complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+        glBindFramebuffer(GL_FRAMEBUFFER, draw_fbo);
+    }
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    if (!complete) {
+        std::cout << "Failed to create the offscreen framebuffer" << std::endl;
+        return false;
+    }
+    glViewport(0, 0, width, height);
+    return true;
+}
+
+void GlContext::destroy() {
+    if (kind == WINDOW) {
+        // also after a failed create(); harmless before glfwInit()
+        glfwTerminate();
+        win = NULL;
+        return;
+    }
+    if (context) {
+        if (draw_fbo)
+            glDeleteFramebuffers(1, &draw_fbo);
+        if (resolve_fbo)
+            glDeleteFramebuffers(1, &resolve_fbo);
+        if (renderbuffers[0])
+            glDeleteRenderbuffers(3, renderbuffers);
+    }
+    draw_fbo = 0;
+    resolve_fbo = 0;
+    renderbuffers[0] = renderbuffers[1] = renderbuffers[2] = 0;
+#ifdef CLOTH_EGL
+    if (kind == EGL && display) {
+        eglMakeCurrent((EGLDisplay)display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (context)
+            eglDestroyContext((EGLDisplay)display, (EGLContext)context);
+        eglTerminate((EGLDisplay)display);
+    }
+#endif
+#ifdef CLOTH_OSMESA
+    if (kind == OSMESA && context)
+        OSMesaDestroyContext((OSMesaContext)context);
+#endif
+    display = NULL;
+    context = NULL;
+    std::vector<unsigned char>().swap(osmesa_pixels);
+    kind = WINDOW;
+}
+
+bool GlContext::should_close() const {
+    if (kind == WINDOW)
+        return win == NULL || glfwWindowShouldClose(win);
+    return frames >= max_frames;
+}
+
+void GlContext::swap() {
+    if (kind == WINDOW) {
+        glfwSwapBuffers(win);
+        return;
+    }
+    resolve();
+    // nothing presents the frame, so hand it to the driver like a swap would
+    glFlush();
+    ++frames;
+    resolved = false;
+}
+
+GLuint GlContext::resolve() {
+    if (resolve_fbo && !resolved) {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, draw_fbo);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, resolve_fbo);
+        glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, draw_fbo);
+        resolved = true;
+    }
+    return framebuffer();
+}
+
+double GlContext::time() const {
+    if (kind == WINDOW)
+        return glfwGetTime();
+    return frames / 60.0;
+}
+
+void GlContext::framebuffer_size(int* width, int* height) const {
+    if (kind == WINDOW) {
+        glfwGetFramebufferSize(win, width, height);
+        return;
+    }
+    *width = this->width;
+    *height = this->height;
+}
@@ -0,0 +1,90 @@
+#ifndef GL_CONTEXT_H
+#define GL_CONTEXT_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <vector>
+
+// OpenGL 3.3 core context of a demo, either in a GLFW window or headless,
+// without a display or a GPU (e.g. Mesa's llvmpipe on a build machine).
+// A headless context draws into a framebuffer object of the requested size
+// that stays bound, so the demos draw the same way in both cases:
+//
+//     GlContext context;
+//     if (!context.create(800, 600, "OpenGL Project"))
+//         return -1;
+//     while (!context.should_close()) {
+//         draw(context.time());
+//         context.swap();
+//     }
+//
+// CLOTH_HEADLESS=egl or osmesa picks a headless backend (any other value
+// the first one built in). They are built with CLOTH_EGL (surfaceless EGL,
+// link libEGL) and CLOTH_OSMESA (link libOSMesa). A headless run ends after
+// CLOTH_FRAMES frames, 600 by default, and its clock advances 1/60 s per
+// frame, so it gives the same frames however fast the machine is.
+//
+// window() is NULL without a window, and GLFW is then never initialised.
+// GLFW asserts that a window argument is not NULL, so callbacks, input and
+// glfwPollEvents() must only be used when window() is set.
+class GlContext {
+public:
+    enum Backend { WINDOW, EGL, OSMESA };
+
+    GlContext();
+    ~GlContext();
+
+    GlContext(const GlContext&) = delete;
+    GlContext& operator=(const GlContext&) = delete;
+
+    // Backend CLOTH_HEADLESS asks for; WINDOW when it is not set.
+    static Backend requested();
+
+    // Creates the context, makes it current and loads the GL functions with
+    // glad. samples > 0 asks for multisampling. Prints why and returns false
+    // if any of it fails.
+    bool create(int width, int height, const char* title, int samples = 0, Backend backend = requested());
+    void destroy();
+
+    bool should_close() const;
+    // Ends the frame: swaps the window's buffers, or resolves the
+    // multisampled framebuffer and counts the frame.
+    void swap();
+    // Resolves the multisampled framebuffer now rather than in swap() and
+    // returns framebuffer(), to read the frame back before swap().
+    GLuint resolve();
+    // Seconds since create(): glfwGetTime() in a window, frames / 60
+    // headless.
+    double time() const;
+    void framebuffer_size(int* width, int* height) const;
+
+    Backend backend() const { return kind; }
+    bool headless() const { return kind != WINDOW; }
+    GLFWwindow* window() const { return win; }
+    // Framebuffer the finished frames are in, e.g. to read them back: 0 for
+    // a window.
+    GLuint framebuffer() const { return resolve_fbo ? resolve_fbo : draw_fbo; }
+    int frame() const { return frames; }
+
+private:
+    bool create_window(const char* title, int samples);
+    bool create_egl();
+    bool create_osmesa();
+    bool create_framebuffer(int samples);
+
+    Backend kind;
+    GLFWwindow* win;
+    void* display;                  // EGLDisplay
+    void* context;                  // EGLContext or OSMesaContext
+    std::vector<unsigned char> osmesa_pixels;
+    GLuint draw_fbo;
+    GLuint resolve_fbo;             // when draw_fbo is multisampled
+    GLuint renderbuffers[3];        // color, depth-stencil, resolved color
+    int width;
+    int height;
+    int frames;
+    int max_frames;
+    bool resolved;                  // this frame, by resolve()
+};
+
+#endif
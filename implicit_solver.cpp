@@ -0,0 +1,249 @@
+#include "implicit_solver.h"
+#include "cloth_solver.h"
+#include "profiler.h"
+#include <algorithm>
+#include <cmath>
+
+void Vec3Array::resize(int n) {
+    x.resize(n);
+    y.resize(n);
+    z.resize(n);
+}
+
+void Vec3Array::fill(float value) {
+    std::fill(x.begin(), x.end(), value);
+    std::fill(y.begin(), y.end(), value);
+    std::fill(z.begin(), z.end(), value);
+}
+
+static double dot(const Vec3Array& u, const Vec3Array& v) {
+    double sum = 0.0;
+    const int n = (int)u.x.size();
+    for (int i = 0; i < n; ++i)
+        sum += u.x[i] * v.x[i] + u.y[i] * v.y[i] + u.z[i] * v.z[i];
+    return sum;
+}
+
+// u += s * v
+static void axpy(Vec3Array& u, float s, const Vec3Array& v) {
+    const int n = (int)u.x.size();
+    for (int i = 0; i < n; ++i) {
+        u.x[i] += s * v.x[i];
+        u.y[i] += s * v.y[i];
+        u.z[i] += s * v.z[i];
+    }
+}
+
+ImplicitSolver::ImplicitSolver() {
+    stiffness[STRUCTURAL] = 1e4f;
+    stiffness[SHEAR] = 1e3f;
+    stiffness[BENDING] = 1e2f;
+    spring_damping = 1.0f;
+    max_iterations = 50;
+    tolerance = 1e-4f;
+    cg_iterations = 0;
+    cg_residual = 0.0f;
+    built = false;
+}
+
+void ImplicitSolver::set_stiffness(ConstraintType type, float stiffness) {
+    this->stiffness[type] = stiffness;
+    if (built) {
+        // stiffness is copied per spring, refresh it
+        int e = 0;
+        for (int t = 0; t < CONSTRAINT_TYPES; ++t)
+            for (int c = 0; c < links[t].size(); ++c, ++e)
+                k[e] = this->stiffness[t];
+    }
+}
+
+float ImplicitSolver::get_stiffness(ConstraintType type) const {
+    return stiffness[type];
+}
+
+void ImplicitSolver::set_spring_damping(float damping) {
+    spring_damping = damping;
+}
+
+void ImplicitSolver::set_cg(int max_iterations, float tolerance) {
+    this->max_iterations = max_iterations > 0 ? max_iterations : 1;
+    this->tolerance = tolerance;
+}
+
+void ImplicitSolver::build(const ClothParticles& p) {
+    build_grid_links(p, links);
+
+    a.clear(); b.clear(); rest.clear(); k.clear();
+    for (int t = 0; t < CONSTRAINT_TYPES; ++t) {
+        const DistanceConstraints& l = links[t];
+        a.insert(a.end(), l.a.begin(), l.a.end());
+        b.insert(b.end(), l.b.begin(), l.b.end());
+        rest.insert(rest.end(), l.rest.begin(), l.rest.end());
+        k.insert(k.end(), l.size(), stiffness[t]);
+    }
+    blocks.resize(a.size());
+
+    const int n = p.size();
+    mass.resize(n);
+    movable.resize(n);
+    rhs.resize(n); dv.resize(n); r.resize(n); d.resize(n);
+    q.resize(n); s.resize(n); diag.resize(n);
+    built = true;
+}
+
+// Computes the spring blocks, the diagonal used as preconditioner and the
+// right hand side h (f + h df/dx v).
+void ImplicitSolver::assemble(const ClothParticles& p, float h, const float gravity[3]) {
+    PROFILE_ZONE("implicit_assemble");
+    const int n = p.size();
+    for (int i = 0; i < n; ++i) {
+        float w = p.inv_mass[i];
+        movable[i] = w > 0.0f ? 1.0f : 0.0f;
+        mass[i] = w > 0.0f ? 1.0f / w : 1.0f;
+        rhs.x[i] = h * mass[i] * gravity[0];
+        rhs.y[i] = h * mass[i] * gravity[1];
+        rhs.z[i] = h * mass[i] * gravity[2];
+        diag.x[i] = diag.y[i] = diag.z[i] = mass[i];
+    }
+
+    const float h2 = h * h;
+    const float hc = h * spring_damping;
+    const int springs = (int)a.size();
+    for (int e = 0; e < springs; ++e) {
+        int i = a[e], j = b[e];
+        float dx = p.x[i] - p.x[j];
+        float dy = p.y[i] - p.y[j];
+        float dz = p.z[i] - p.z[j];
+        float len = sqrtf(dx * dx + dy * dy + dz * dz);
+        Block& B = blocks[e];
+        if (len < 1e-9f) {
+            B.xx = B.xy = B.xz = B.yy = B.yz = B.zz = 0.0f;
+            continue;
+        }
+        dx /= len; dy /= len; dz /= len;
+
+        // spring and damping forces acting on i, j gets the opposite
+        float uvx = p.vx[i] - p.vx[j];
+        float uvy = p.vy[i] - p.vy[j];
+        float uvz = p.vz[i] - p.vz[j];
+        float f = -k[e] * (len - rest[e]) - spring_damping * (uvx * dx + uvy * dy + uvz * dz);
+
+        // -df/dx = k (d d^T + s (I - d d^T)); s is clamped at 0 so that
+        // compressed springs keep the matrix positive definite
+        float sk = len > rest[e] ? k[e] * (1.0f - rest[e] / len) : 0.0f;
+        float kd = h2 * (k[e] - sk);        // along d d^T
+        float ki = h2 * sk;                 // along I
+        Block S;                            // h^2 * stiffness part alone
+        S.xx = kd * dx * dx + ki; S.xy = kd * dx * dy; S.xz = kd * dx * dz;
+        S.yy = kd * dy * dy + ki; S.yz = kd * dy * dz; S.zz = kd * dz * dz + ki;
+
+        float Sux = S.xx * uvx + S.xy * uvy + S.xz * uvz;
+        float Suy = S.xy * uvx + S.yy * uvy + S.yz * uvz;
+        float Suz = S.xz * uvx + S.yz * uvy + S.zz * uvz;
+        float rx = h * f * dx - Sux;
+        float ry = h * f * dy - Suy;
+        float rz = h * f * dz - Suz;
+        rhs.x[i] += rx; rhs.y[i] += ry; rhs.z[i] += rz;
+        rhs.x[j] -= rx; rhs.y[j] -= ry; rhs.z[j] -= rz;
+
+        // add -h df/dv = h c d d^T
+        B.xx = S.xx + hc * dx * dx; B.xy = S.xy + hc * dx * dy; B.xz = S.xz + hc * dx * dz;
+        B.yy = S.yy + hc * dy * dy; B.yz = S.yz + hc * dy * dz; B.zz = S.zz + hc * dz * dz;
+
+        diag.x[i] += B.xx; diag.y[i] += B.yy; diag.z[i] += B.zz;
+        diag.x[j] += B.xx; diag.y[j] += B.yy; diag.z[j] += B.zz;
+    }
+}
+
+void ImplicitSolver::multiply(const Vec3Array& v, Vec3Array& out) const {
+    PROFILE_ZONE("implicit_multiply");
+    const int n = (int)mass.size();
+    for (int i = 0; i < n; ++i) {
+        out.x[i] = mass[i] * v.x[i];
+        out.y[i] = mass[i] * v.y[i];
+        out.z[i] = mass[i] * v.z[i];
+    }
+
+    const int springs = (int)a.size();
+    for (int e = 0; e < springs; ++e) {
+        int i = a[e], j = b[e];
+        const Block& B = blocks[e];
+        float ux = v.x[i] - v.x[j];
+        float uy = v.y[i] - v.y[j];
+        float uz = v.z[i] - v.z[j];
+        float bx = B.xx * ux + B.xy * uy + B.xz * uz;
+        float by = B.xy * ux + B.yy * uy + B.yz * uz;
+        float bz = B.xz * ux + B.yz * uy + B.zz * uz;
+        out.x[i] += bx; out.y[i] += by; out.z[i] += bz;
+        out.x[j] -= bx; out.y[j] -= by; out.z[j] -= bz;
+    }
+    filter(out);
+}
+
+// Pinned particles cannot change velocity: zero their components.
+void ImplicitSolver::filter(Vec3Array& v) const {
+    const int n = (int)movable.size();
+    for (int i = 0; i < n; ++i) {
+        v.x[i] *= movable[i];
+        v.y[i] *= movable[i];
+        v.z[i] *= movable[i];
+    }
+}
+
+void ImplicitSolver::step(ClothParticles& p, float h, const float gravity[3]) {
+    PROFILE_ZONE("implicit_step");
+    if (!built)
+        build(p);
+    assemble(p, h, gravity);
+    filter(rhs);
+
+    const int n = p.size();
+    dv.fill(0.0f);
+    r = rhs;
+    for (int i = 0; i < n; ++i) {
+        s.x[i] = r.x[i] / diag.x[i];
+        s.y[i] = r.y[i] / diag.y[i];
+        s.z[i] = r.z[i] / diag.z[i];
+    }
+    d = s;
+    double rs = dot(r, s);
+    const double limit = (double)tolerance * tolerance * dot(rhs, rhs);
+
+    cg_iterations = 0;
+    double rr = dot(r, r);
+    while (cg_iterations < max_iterations && rr > limit) {
+        multiply(d, q);
+        double dq = dot(d, q);
+        if (dq <= 0.0)
+            break;
+        float alpha = (float)(rs / dq);
+        axpy(dv, alpha, d);
+        axpy(r, -alpha, q);
+        ++cg_iterations;
+
+        rr = dot(r, r);
+        for (int i = 0; i < n; ++i) {
+            s.x[i] = r.x[i] / diag.x[i];
+            s.y[i] = r.y[i] / diag.y[i];
+            s.z[i] = r.z[i] / diag.z[i];
+        }
+        double rs_new = dot(r, s);
+        float beta = (float)(rs_new / rs);
+        rs = rs_new;
+        for (int i = 0; i < n; ++i) {
+            d.x[i] = s.x[i] + beta * d.x[i];
+            d.y[i] = s.y[i] + beta * d.y[i];
+            d.z[i] = s.z[i] + beta * d.z[i];
+        }
+    }
+    cg_residual = (float)sqrt(rr);
+
+    for (int i = 0; i < n; ++i) {
+        p.vx[i] += dv.x[i];
+        p.vy[i] += dv.y[i];
+        p.vz[i] += dv.z[i];
+        p.x[i] += h * p.vx[i] * movable[i];
+        p.y[i] += h * p.vy[i] * movable[i];
+        p.z[i] += h * p.vz[i] * movable[i];
+    }
+}
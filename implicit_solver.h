@@ -0,0 +1,71 @@
+#ifndef IMPLICIT_SOLVER_H
+#define IMPLICIT_SOLVER_H
+
+#include <vector>
+#include "xpbd_solver.h"
+
+struct ClothParticles;
+
+// Three float arrays of one value per particle.
+struct Vec3Array {
+    std::vector<float> x, y, z;
+
+    void resize(int n);
+    void fill(float value);
+};
+
+// Backward Euler mass-spring integrator in the style of Baraff and Witkin,
+// "Large Steps in Cloth Simulation". Every step solves
+//     (M - h df/dv - h^2 df/dx) dv = h (f + h df/dx v)
+// with preconditioned conjugate gradients. The matrix is never assembled:
+// each spring keeps its 3x3 block and the product is applied spring by
+// spring. Springs follow the same grid links as XpbdSolver.
+class ImplicitSolver {
+public:
+    ImplicitSolver();
+
+    void build(const ClothParticles& p);
+    bool is_built() const { return built; }
+
+    void set_stiffness(ConstraintType type, float stiffness);
+    float get_stiffness(ConstraintType type) const;
+    void set_spring_damping(float damping);
+    void set_cg(int max_iterations, float tolerance);
+
+    int last_iterations() const { return cg_iterations; }
+    float last_residual() const { return cg_residual; }
+
+    // Advances velocities and positions by h. gravity is an acceleration.
+    void step(ClothParticles& p, float h, const float gravity[3]);
+
+private:
+    // Symmetric 3x3 block of one spring.
+    struct Block {
+        float xx, xy, xz, yy, yz, zz;
+    };
+
+    void assemble(const ClothParticles& p, float h, const float gravity[3]);
+    void multiply(const Vec3Array& v, Vec3Array& out) const;
+    void filter(Vec3Array& v) const;
+
+    DistanceConstraints links[CONSTRAINT_TYPES];
+    float stiffness[CONSTRAINT_TYPES];
+    float spring_damping;
+
+    // all springs of all types in one list
+    std::vector<int> a, b;
+    std::vector<float> rest, k;
+    std::vector<Block> blocks;
+
+    std::vector<float> mass;
+    std::vector<float> movable;     // 0 for pinned particles, 1 otherwise
+    Vec3Array rhs, dv, r, d, q, s, diag;
+
+    int max_iterations;
+    float tolerance;
+    int cg_iterations;
+    float cg_residual;
+    bool built;
+};
+
+#endif
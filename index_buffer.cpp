@@ -0,0 +1,55 @@
+#include "index_buffer.h"
+#include <cstddef>
+#include <cstdint>
+
+IndexBuffer::IndexBuffer() {
+    ebo = 0;
+    index_type = GL_UNSIGNED_INT;
+}
+
+IndexBuffer::~IndexBuffer() {
+    release();
+}
+
+int IndexBuffer::add(const std::vector<int>& indices, int base_vertex) {
+    Range r;
+    r.first = (GLsizei)staged.size();
+    r.count = (GLsizei)indices.size();
+    staged.reserve(staged.size() + indices.size());
+    for (size_t i = 0; i < indices.size(); ++i)
+        staged.push_back((unsigned int)(indices[i] + base_vertex));
+    ranges.push_back(r);
+    return (int)ranges.size() - 1;
+}
+
+void IndexBuffer::upload(int vertex_count) {
+    if (ebo)
+        glDeleteBuffers(1, &ebo);
+    glGenBuffers(1, &ebo);
+    // the binding is part of the bound VAO's state
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+
+    if (vertex_count <= 65536) {
+        index_type = GL_UNSIGNED_SHORT;
+        std::vector<uint16_t> narrow(staged.begin(), staged.end());
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, narrow.size() * sizeof(uint16_t), narrow.data(), GL_STATIC_DRAW);
+    } else {
+        index_type = GL_UNSIGNED_INT;
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, staged.size() * sizeof(unsigned int), staged.data(), GL_STATIC_DRAW);
+    }
+    std::vector<unsigned int>().swap(staged);
+}
+
+void IndexBuffer::release() {
+    if (ebo)
+        glDeleteBuffers(1, &ebo);
+    ebo = 0;
+    ranges.clear();
+    staged.clear();
+}
+
+void IndexBuffer::draw(int list, GLenum mode) const {
+    const Range& r = ranges[list];
+    const size_t size = index_type == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(unsigned int);
+    glDrawElements(mode, r.count, index_type, (void*)(r.first * size));
+}
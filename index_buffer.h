@@ -0,0 +1,58 @@
+#ifndef INDEX_BUFFER_H
+#define INDEX_BUFFER_H
+
+#include <glad/glad.h>
+#include <vector>
+
+// Element buffer holding one or more index lists of the same mesh, e.g. the
+// triangles and the wireframe lines. The lists are packed one after another
+// into a single GL_ELEMENT_ARRAY_BUFFER, which the VAO records, so drawing
+// only needs the VAO bound and no index data crosses to the driver per frame:
+//
+//     glBindVertexArray(VAO);
+//     ... vertex attributes ...
+//     int tris = ibo.add(indices);
+//     int lines = ibo.add(lineIndices);
+//     ibo.upload(vertex_count);                 // while the VAO is bound
+//     glBindVertexArray(0);
+//     ...
+//     glBindVertexArray(VAO);
+//     ibo.draw(tris, GL_TRIANGLES);             // every frame
+//
+// Indices are stored as 16-bit when every vertex fits, which halves the
+// buffer and the index fetch bandwidth; otherwise as 32-bit.
+class IndexBuffer {
+public:
+    IndexBuffer();
+    ~IndexBuffer();
+
+    IndexBuffer(const IndexBuffer&) = delete;
+    IndexBuffer& operator=(const IndexBuffer&) = delete;
+
+    // Queues a list for upload() and returns its number for draw().
+    // base_vertex is added to every index, for meshes packed one after
+    // another into the same vertex buffer.
+    int add(const std::vector<int>& indices, int base_vertex = 0);
+    // Creates the buffer and binds it to the VAO that is bound now. The
+    // queued lists are freed; vertex_count picks the index type.
+    void upload(int vertex_count);
+    void release();
+
+    // Draws list with the VAO bound by the caller.
+    void draw(int list, GLenum mode) const;
+    GLsizei count(int list) const { return ranges[list].count; }
+    GLenum type() const { return index_type; }
+
+private:
+    struct Range {
+        GLsizei first;          // in indices from the start of the buffer
+        GLsizei count;
+    };
+
+    GLuint ebo;
+    GLenum index_type;
+    std::vector<Range> ranges;
+    std::vector<unsigned int> staged;
+};
+
+#endif
@@ -0,0 +1,212 @@
+#include "job_system.h"
+#include "profiler.h"
+
+struct Job {
+    std::function<void()> fn;
+    std::atomic<int> waiting;       // unfinished dependencies, +1 while submitting
+    std::atomic<bool> done;
+    std::mutex mutex;
+    std::vector<JobHandle> dependents;
+};
+
+// Queue of the current thread: a worker's own or 0 for outside threads.
+static thread_local const JobSystem* current_system = NULL;
+static thread_local int current_queue = 0;
+
+JobSystem::JobSystem(int threads) {
+    if (threads <= 0)
+        threads = (int)std::thread::hardware_concurrency();
+    if (threads < 1)
+        threads = 1;
+
+    queued = 0;
+    sleepers = 0;
+    quit = false;
+    for (int i = 0; i < threads; ++i)
+        queues.emplace_back(new Queue);
+    for (int i = 1; i < threads; ++i)
+        workers.emplace_back(&JobSystem::worker, this, i);
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        quit = true;
+    }
+    wake.notify_all();
+    for (std::thread& t : workers)
+        t.join();
+}
+
+void JobSystem::push(const JobHandle& job) {
+    int index = current_system == this ? current_queue : 0;
+    {
+        std::lock_guard<std::mutex> lock(queues[index]->mutex);
+        queues[index]->jobs.push_back(job);
+    }
+    ++queued;
+    if (sleepers > 0) {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        wake.notify_all();
+    }
+}
+
+// Newest job of the own queue, otherwise the oldest job of another queue.
+JobHandle JobSystem::take() {
+    if (queued == 0)
+        return nullptr;
+    const int count = (int)queues.size();
+    const int own = current_system == this ? current_queue : 0;
+    {
+        Queue& q = *queues[own];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (!q.jobs.empty()) {
+            JobHandle job = q.jobs.back();
+            q.jobs.pop_back();
+            --queued;
+            return job;
+        }
+    }
+    for (int k = 1; k < count; ++k) {
+        Queue& q = *queues[(own + k) % count];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (!q.jobs.empty()) {
+            JobHandle job = q.jobs.front();
+            q.jobs.pop_front();
+            --queued;
+            return job;
+        }
+    }
+    return nullptr;
+}
+
+void JobSystem::run(const JobHandle& job) {
+    {
+        PROFILE_ZONE("job");
+        job->fn();
+    }
+    job->fn = nullptr;
+
+    std::vector<JobHandle> ready;
+    {
+        std::lock_guard<std::mutex> lock(job->mutex);
+        job->done = true;
+        ready.swap(job->dependents);
+    }
+    for (const JobHandle& next : ready)
+        if (--next->waiting == 0)
+            push(next);
+
+    // threads blocked in wait() or parallel_for() check their job again
+    if (sleepers > 0) {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        wake.notify_all();
+    }
+}
+
+JobHandle JobSystem::submit(std::function<void()> fn, const std::vector<JobHandle>& deps) {
+    JobHandle job = std::make_shared<Job>();
+    job->fn = std::move(fn);
+    job->waiting = 1;
+    job->done = false;
+    for (const JobHandle& dep : deps) {
+        if (!dep)
+            continue;
+        std::lock_guard<std::mutex> lock(dep->mutex);
+        if (!dep->done) {
+            dep->dependents.push_back(job);
+            ++job->waiting;
+        }
+    }
+    if (--job->waiting == 0)
+        push(job);
+    return job;
+}
+
+bool JobSystem::finished(const JobHandle& job) const {
+    return !job || job->done;
+}
+
+// Runs other jobs until done() holds, sleeping when there is nothing to run.
+template <class Done>
+void JobSystem::help_until(Done done) {
+    while (!done()) {
+        JobHandle job = take();
+        if (job) {
+            run(job);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleep_mutex);
+        ++sleepers;
+        wake.wait(lock, [&] { return queued > 0 || done(); });
+        --sleepers;
+    }
+}
+
+void JobSystem::wait(const JobHandle& job) {
+    help_until([&] { return finished(job); });
+}
+
+void JobSystem::parallel_for(int count, int grain, const std::function<void(int, int)>& fn) {
+    if (count <= 0)
+        return;
+    if (grain < 1)
+        grain = 1;
+    if (size() == 1 || count < 2 * grain) {
+        fn(0, count);
+        return;
+    }
+
+    // Ranges of `grain` items, but not more than 16 per thread: the extra
+    // ranges are what idle threads steal when the work is uneven.
+    int ranges = count / grain;
+    if (ranges > 16 * size())
+        ranges = 16 * size();
+
+    std::atomic<int> remaining(ranges - 1);
+    for (int r = 1; r < ranges; ++r) {
+        int begin = (int)((long long)count * r / ranges);
+        int end = (int)((long long)count * (r + 1) / ranges);
+        submit([&fn, &remaining, begin, end] {
+            fn(begin, end);
+            --remaining;
+        });
+    }
+    fn(0, (int)((long long)count / ranges));
+    help_until([&] { return remaining == 0; });
+}
+
+void JobSystem::worker(int index) {
+    current_system = this;
+    current_queue = index;
+    PROFILE_THREAD("worker %d", index);
+    for (;;) {
+        JobHandle job = take();
+        if (job) {
+            run(job);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleep_mutex);
+        if (quit)
+            return;
+        ++sleepers;
+        wake.wait(lock, [this] { return quit || queued > 0; });
+        --sleepers;
+    }
+}
+
+JobSystem& shared_jobs() {
+    static JobSystem jobs;
+    return jobs;
+}
+
+void parallel_for(JobSystem* jobs, int count, int grain, const std::function<void(int, int)>& fn) {
+    if (jobs)
+        jobs->parallel_for(count, grain, fn);
+    else if (count > 0)
+        fn(0, count);
+}
+
+extern "C" void job_parallel_for(int count, int grain, job_range_fn fn, void *context) {
+    shared_jobs().parallel_for(count, grain, [=](int begin, int end) { fn(context, begin, end); });
+}
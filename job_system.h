@@ -0,0 +1,85 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#ifdef __cplusplus
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct Job;
+typedef std::shared_ptr<Job> JobHandle;
+
+// Work-stealing scheduler. Every thread has its own queue: it takes its
+// newest job first and, when the queue is empty, steals the oldest job of
+// another thread, so uneven loops spread out over all threads by themselves.
+// Threads waiting for a job run other jobs in the meantime, so jobs may wait
+// for jobs and loops may nest.
+class JobSystem {
+public:
+    // Number of threads including the caller; 0 means one per hardware thread.
+    explicit JobSystem(int threads = 0);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    int size() const { return (int)workers.size() + 1; }
+
+    // Queues fn to run once every job in deps has finished.
+    JobHandle submit(std::function<void()> fn, const std::vector<JobHandle>& deps = {});
+    bool finished(const JobHandle& job) const;
+    // Runs queued jobs on the calling thread until job has finished.
+    void wait(const JobHandle& job);
+
+    // Calls fn(begin, end) on ranges of about grain items covering
+    // [0, count) and returns once all of them are done. Loops shorter than
+    // 2 * grain run on the calling thread alone.
+    void parallel_for(int count, int grain, const std::function<void(int, int)>& fn);
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<JobHandle> jobs;
+    };
+
+    void push(const JobHandle& job);
+    JobHandle take();
+    void run(const JobHandle& job);
+    template <class Done> void help_until(Done done);
+    void worker(int index);
+
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<Queue>> queues;     // [0] is shared by outside threads
+    std::atomic<int> queued;
+    std::atomic<int> sleepers;
+    std::mutex sleep_mutex;
+    std::condition_variable wake;
+    bool quit;
+};
+
+// Job system shared by the whole program, started at first use with one
+// thread per hardware thread.
+JobSystem& shared_jobs();
+
+// jobs->parallel_for, or fn(0, count) on the calling thread when jobs is NULL.
+void parallel_for(JobSystem* jobs, int count, int grain, const std::function<void(int, int)>& fn);
+
+extern "C" {
+#endif
+
+// C interface to shared_jobs(): calls fn(context, begin, end) on ranges of
+// about grain items covering [0, count) and returns once all are done.
+typedef void (*job_range_fn)(void *context, int begin, int end);
+void job_parallel_for(int count, int grain, job_range_fn fn, void *context);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -5,19 +5,46 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <iostream>
 #include <vector>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
 #include <cmath>
 #include <cstdlib>
 #include <ctime>
+#include "cloth_solver.h"
+#include "sim_clock.h"
+#include "trajectory.h"
+#include "particle_renderer.h"
+#include "shader_program.h"
+#include "frustum.h"
+#include "profiler.h"
+#include "gl_context.h"
+#include "frame_capture.h"
+#include "triple_buffer.h"
+#include "frame_stats.h"
 //#include <Windows.h>
 
+// Состояние полотна, которое поток симуляции отдаёт потоку отрисовки:
+// положения двух последних шагов для интерполяции и сферы кусков частиц
+// для отсечения. Поток отрисовки только читает его
+struct ClothSnapshot {
+    std::vector<float> prev_x, prev_y, prev_z;
+    std::vector<float> x, y, z;
+    std::vector<float> tile_x, tile_y, tile_z, tile_r;
+    double time;    // момент (по часам контекста), когда x, y, z были текущими
+};
+
 const char* vertexShaderSource = "#version 330 core\n"
 "layout (location = 0) in vec3 aPos;\n"
 //"layout (location = 0) in vec3 aPos2;\n"
-"uniform mat4 view;\n"
+"layout (location = 1) in float aX;\n"
+"layout (location = 2) in float aY;\n"
+"layout (location = 3) in float aZ;\n"
 //"uniform mat4 view2;\n"
 "void main()\n"
 "{\n"
-"   gl_Position = view * vec4(aPos, 1.0);\n"
+"   gl_Position = vec4(aPos + vec3(aX, aY, aZ), 1.0);\n"
 //"   gl_Position2 = view2 * vec4(aPos2, 1.0);\n"
 "}\0";
 
@@ -72,78 +99,22 @@ const unsigned int SCR_HEIGHT = 800;
 
 int main()
 {
-    // glfw: инициализация и конфигурирование
-    glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-#ifdef __APPLE__
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE); // раскомментируйте эту строку, если используете macOS
-#endif
-
-    // glfw: создание окна
-    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "OpenGL Project", NULL, NULL);
-    if (window == NULL)
-    {
-        std::cout << "Failed to create GLFW window" << std::endl;
-        glfwTerminate();
+    // Окно GLFW или, если задана CLOTH_HEADLESS, контекст без окна, который
+    // рисует во внеэкранный буфер кадра (см. gl_context.h)
+    GlContext context;
+    if (!context.create(SCR_WIDTH, SCR_HEIGHT, "OpenGL Project"))
         return -1;
-    }
-    glfwMakeContextCurrent(window);
-    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-
-    // glad: загрузка всех указателей на OpenGL-функции
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
-    {
-        std::cout << "Failed to initialize GLAD" << std::endl;
-        return -1;
-    }
+    GLFWwindow* window = context.window();
+    // Без окна функциям GLFW нечего передать: окно NULL, а GLFW не инициализирован
+    if (window)
+        glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 
     // Компилирование нашей шейдерной программы
 
-    // Вершинный шейдер
-    int vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-    glCompileShader(vertexShader);
-
-    // Проверка на наличие ошибок компилирования вершинного шейдера
-    int success;
-    char infoLog[512];
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-    if (!success)
-    {
-        glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
-    }
-
-    // Фрагментный шейдер
-    int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-    glCompileShader(fragmentShader);
-
-    // Проверка на наличие ошибок компилирования фрагментного шейдера
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-    if (!success)
-    {
-        glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
-    }
-
-    // Связывание шейдеров
-    int shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-
-    // Проверка на наличие ошибок компилирования связывания шейдеров
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-    if (!success) {
-        glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
-    }
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+    // SHADER_CACHE=папка сохраняет собранную программу в двоичном виде, и
+    // следующие запуски не компилируют шейдеры
+    ShaderProgram program;
+    program.build(vertexShaderSource, NULL, fragmentShaderSource, getenv("SHADER_CACHE"));
 
     // Указывание вершин (и буферов) и настройка вершинных атрибутов
     float vertices[] = {
@@ -166,29 +137,11 @@ int main()
 
     int count_of_particles_in_one_lawyer = 51;
     int lawyers = 9;
-    std::vector< std::vector<glm::vec3> > particles_locations (count_of_particles_in_one_lawyer, std::vector<glm::vec3>(lawyers) );
 
-  
+    // Полотно 51 x 9 частиц с шагом 0.025, верхний ряд на высоте 0.8
+    ClothSolver cloth(count_of_particles_in_one_lawyer, lawyers, 0.025f, 0.0f, 0.8f, 0.0f);
+    ClothParticles& particles = cloth.particles();
 
-    float y = 0.8f;
-    for (int i = 0; i < count_of_particles_in_one_lawyer; ++i) {
-        float x = 0.0f;
-        for (int j = 0; j < lawyers; ++j) {
-            //std::cout << "x valuse is: " << x << "\n";
-            particles_locations[i][j] = glm::vec3(x, y, 0.0f);
-            x = x + 0.025f;
-        }
-        //particles_locations.push_back(glm::vec3(0.0f, y, 0.0f));  //from (0.0, 0.9, 0.0) to (0.0, -0.9, 0.0)
-        y = y - 0.025f;
-    }
-
-    #if 0
-    for (int i = 0; i < count_of_particles_in_one_lawyer; ++i) {
-        for (int j = 0; j < lawyers; ++j) {
-            std::cout << "x = " << particles_locations[i][j].x << " y = " << particles_locations[i][j].y << "\n";
-        }
-    }
-    #endif 
 
 
     unsigned int VBO, VAO;
@@ -212,34 +165,63 @@ int main()
     // Модификация других VAO требует вызов glBindVertexArray(), поэтому мы обычно не снимаем привязку VAO (или VBO), когда это не требуется напрямую
     glBindVertexArray(VAO);
 
+    // Частицы рисуются одним instanced-вызовом за кадр: положения всех
+    // частиц загружаются в буфер экземпляров, а не по матрице на частицу
+    ParticleRenderer renderer;
+    renderer.init(VBO, 6, GL_LINE_LOOP);
 
     // Раскомментируйте следующую строку для отрисовки полигонов в режиме каркаса
     // glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
     srand(time(NULL));
     //int lifetime = 1500000;
 
-    std::vector<float> velocityY;
-    std::vector<float> velocityX;
-
-    float vx1 = 0.0f ;
-    for (int i = 0; i < count_of_particles_in_one_lawyer / 2; i++) {
-        //float xr = (rand() % 2 + 1);
-        //float yr = (rand() % 2 + 1);
-        //velocityY.push_back(yr / 300);
-        velocityX.push_back(vx1);
-        vx1 = vx1 + 0.0001f;     
-        //vx1 = pow(vx1, 1.0f/(particles_locations.size()) )   + 0.00001f;
+    // Полотно висит на верхнем ряду и держится на XPBD-связях, вместо
+    // подобранного вручную профиля скоростей даём ему один боковой толчок
+    // Физика идёт шагами по 1/60 с в своём потоке независимо от частоты
+    // кадров монитора, а между шагами положения частиц интерполируются
+    SimClock clock(1.0 / 60.0);
+    const double dt = clock.get_dt();
+    // Частицы рисуются кусками по 64 подряд; кусок, чья ограничивающая
+    // сфера целиком за краем экрана, не рисуется. Шейдер не применяет
+    // матриц, поэтому пирамида видимости - куб -1..1 пространства отсечения
+    const int tile = 64;
+    const int tiles = (particles.size() + tile - 1) / tile;
+    const int n = particles.size();
+    std::vector<int> visible_tiles(tiles);
+    const float identity[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+    Frustum frustum;
+    frustum.extract(identity);
+    // CLOTH_RECORD=путь записывает каждый шаг (положения и скорости) в файл
+    // траектории для разбора после запуска
+    TrajectoryRecorder recorder;
+    if (const char* record_path = getenv("CLOTH_RECORD")) {
+        if (!recorder.open(record_path, particles.rows, particles.cols, TRAJECTORY_VELOCITIES))
+            std::cout << "Failed to open trajectory file " << record_path << std::endl;
     }
-
-    velocityX.push_back(vx1);
-
-    for (int i = count_of_particles_in_one_lawyer / 2 + 1; i < count_of_particles_in_one_lawyer; i++) {
-        velocityX.push_back(velocityX[count_of_particles_in_one_lawyer / 2 - (i - count_of_particles_in_one_lawyer / 2)]);
+    // CLOTH_CAPTURE=путь записывает кадры: cloth.y4m - видео, frames/%05d.png
+    // или .ppm - по файлу на кадр. Частота записи CLOTH_CAPTURE_FPS (30 по
+    // умолчанию) не зависит от частоты кадров и шагов симуляции; кадры
+    // читаются асинхронно и пишутся на диск фоновыми потоками
+    FrameCapture capture;
+    if (const char* capture_path = getenv("CLOTH_CAPTURE")) {
+        const char* capture_fps = getenv("CLOTH_CAPTURE_FPS");
+        int width, height;
+        context.framebuffer_size(&width, &height);
+        if (!capture.open(capture_path, width, height, capture_fps ? atof(capture_fps) : 30.0))
+            std::cout << "Failed to open capture " << capture_path << std::endl;
     }
-   
-
-    for (int i = 0; i < count_of_particles_in_one_lawyer; i++) {
-        velocityY.push_back(0.0f);
+    cloth.set_method(ClothSolver::XPBD);
+    // Частицы не подходят друг к другу ближе 0.02: пары ищет пространственный
+    // хеш, а не перебор всех пар
+    cloth.xpbd().set_collision_radius(0.02f);
+    for (int j = 0; j < lawyers; ++j) {
+        cloth.pin(0, j);
+    }
+    for (int i = 1; i < count_of_particles_in_one_lawyer; i++) {
+        float push = 1.5f * i / (count_of_particles_in_one_lawyer - 1);
+        for (int j = 0; j < lawyers; ++j) {
+            cloth.set_velocity(i, j, push, 0.0f, 0.0f);
+        }
     }
 
     // double speed[] = {
@@ -252,12 +234,96 @@ int main()
      //double vx1 = 0.009, vy1 = -0.009;
      //double vx2 = -0.009, vy2 = 0.008;
      // Цикл рендеринга
-    double border = 0.95;
-
     //int step = 0;
     //int n = 5; //number of particles
-    while (!glfwWindowShouldClose(window))
+    // В сборке с CLOTH_PROFILE каждые 5 с печатается гистограмма фаз кадра
+    // за последние 5 с, а CLOTH_TRACE=путь по выходе записывает все зоны
+    // в формате Chrome trace_event (chrome://tracing)
+    PROFILE_THREAD("main");
+
+    // Поток симуляции шагает полотном и после каждой пачки шагов публикует
+    // снимок состояния через тройной буфер; поток отрисовки берёт самый
+    // свежий снимок, не копируя его и не дожидаясь симуляции. В окне время
+    // для обоих потоков - glfwGetTime() (её можно звать из любого потока).
+    // Без окна время кадра задаёт поток отрисовки, и каждый кадр ждёт, пока
+    // симуляция дойдёт до него, чтобы кадры не зависели от скорости машины
+    TripleBuffer<ClothSnapshot> snapshots;
+    std::vector<float> prev_x = particles.x, prev_y = particles.y, prev_z = particles.z;
+    auto publish = [&](double state_time) {
+        ClothSnapshot& snap = snapshots.write();
+        snap.prev_x = prev_x;
+        snap.prev_y = prev_y;
+        snap.prev_z = prev_z;
+        snap.x = particles.x;
+        snap.y = particles.y;
+        snap.z = particles.z;
+        // Сферы кусков охватывают оба последних шага, а значит и все
+        // положения, интерполированные между ними (квадрат частицы - 0.05)
+        snap.tile_x.resize(tiles);
+        snap.tile_y.resize(tiles);
+        snap.tile_z.resize(tiles);
+        snap.tile_r.resize(tiles);
+        tile_bounds(snap.prev_x.data(), snap.prev_y.data(), snap.prev_z.data(),
+            snap.x.data(), snap.y.data(), snap.z.data(), n, tile, 0.071f,
+            snap.tile_x.data(), snap.tile_y.data(), snap.tile_z.data(), snap.tile_r.data());
+        snap.time = state_time;
+        snapshots.publish();
+    };
+    publish(0.0);
+    snapshots.update();
+
+    const bool headless = context.headless();
+    std::atomic<bool> simulating(true);
+    std::atomic<double> frame_time(0.0);    // без окна: время текущего кадра
+    std::atomic<double> sim_time(-1.0);     // без окна: до какого времени дошла симуляция
+    std::thread sim_thread([&] {
+        PROFILE_THREAD("sim");
+        FrameStats step_stats;
+        double next_sim_report = 5.0;
+        while (simulating.load(std::memory_order_relaxed)) {
+            const double now = headless ? frame_time.load() : context.time();
+            int steps = clock.tick(now);
+            for (int s = 0; s < steps; ++s) {
+                PROFILE_ZONE("sim_step");
+                auto start = std::chrono::steady_clock::now();
+                if (s == steps - 1) {
+                    prev_x = particles.x;
+                    prev_y = particles.y;
+                    prev_z = particles.z;
+                }
+                for (int k = 0; k < clock.get_substeps(); ++k)
+                    cloth.step((float)clock.substep_dt());
+                if (recorder.is_open())
+                    recorder.append(particles, clock.time() - (steps - 1 - s) * dt);
+                step_stats.add(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+            }
+            if (steps > 0)
+                publish(now - clock.alpha() * dt);
+            if (headless) {
+                sim_time.store(now);
+                if (steps == 0)
+                    std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+            else if (steps == 0) {
+                // До следующего шага делать нечего
+                std::this_thread::sleep_for(std::chrono::duration<double>((1.0 - clock.alpha()) * dt));
+            }
+            if (now >= next_sim_report && step_stats.count() > 0) {
+                step_stats.print(stdout, "sim step");
+                next_sim_report = now + 5.0;
+            }
+        }
+    });
+
+    FrameStats frame_stats;
+    auto last_frame = std::chrono::steady_clock::now();
+    double next_report = 5.0;
+    while (!context.should_close())
     {
+        PROFILE_ZONE("frame");
+        auto frame_start = std::chrono::steady_clock::now();
+        frame_stats.add(std::chrono::duration<double>(frame_start - last_frame).count());
+        last_frame = frame_start;
         // Обработка ввода
         processInput(window);
         glEnable(GL_DEPTH_TEST);
@@ -266,24 +332,50 @@ int main()
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
         // Рисуем наш первый треугольник
-        glUseProgram(shaderProgram);
+        program.use();
         //glBindVertexArray(VAO); // поскольку у нас есть только один VАО, то нет необходимости связывать его каждый раз (но мы сделаем это, чтобы всё было немного организованнее)
         glPointSize(15);
 
-        //Particle particle;
-        for (int i = 0; i < count_of_particles_in_one_lawyer; i++) {
-            for (int j = 0; j < lawyers; ++j) {
-                glm::mat4 view = glm::mat4(1.0f);
-                view = glm::translate(view, particles_locations[i][j]);
-                //view = glm::translate(view, glm::vec3(vertices[3], vertices[4], 0.0f));
-                unsigned int viewLoc = glGetUniformLocation(shaderProgram, "view");
-                glUniformMatrix4fv(viewLoc, 1, GL_FALSE, &view[0][0]);
-                //glBindVertexArray(VAO);
-                //glDrawArrays(GL_POINTS, 0, particles_locations.size());
-                //glDrawArrays(GL_TRIANGLES, 0, 6);
-                glDrawArrays(GL_LINE_LOOP, 0, 6);
+        // Самый свежий снимок симуляции
+        const double now = context.time();
+        if (headless) {
+            PROFILE_ZONE("sim_wait");
+            frame_time.store(now);
+            while (sim_time.load() < now)
+                std::this_thread::yield();
+        }
+        snapshots.update();
+        const ClothSnapshot& snap = snapshots.read();
+        float alpha = (float)std::min(1.0, std::max(0.0, (now - snap.time) / dt));
+        int visible;
+        {
+            PROFILE_ZONE("cull");
+            visible = cull_spheres(frustum, snap.tile_x.data(), snap.tile_y.data(), snap.tile_z.data(),
+                snap.tile_r.data(), tiles, visible_tiles.data());
+        }
+        int drawn = 0;
+        for (int t = 0; t < visible; ++t)
+            drawn += std::min(tile, n - visible_tiles[t] * tile);
+
+        // Интерполированные положения видимых кусков пишутся сразу в
+        // отображённый буфер экземпляров на видеокарте, без промежуточных массивов
+        if (float* draw_xyz = renderer.map(drawn)) {
+            {
+                PROFILE_ZONE("interpolate");
+                int at = 0;
+                for (int t = 0; t < visible; ++t) {
+                    int begin = visible_tiles[t] * tile;
+                    int len = std::min(tile, n - begin);
+                    interpolate(snap.prev_x.data() + begin, snap.x.data() + begin, alpha, draw_xyz + at, len);
+                    interpolate(snap.prev_y.data() + begin, snap.y.data() + begin, alpha, draw_xyz + drawn + at, len);
+                    interpolate(snap.prev_z.data() + begin, snap.z.data() + begin, alpha, draw_xyz + 2 * drawn + at, len);
+                    at += len;
+                }
             }
-          
+
+            //Particle particle;
+            PROFILE_ZONE("draw");
+            renderer.draw_mapped();
         }
         //glm::mat4 view = glm::mat4(1.0f);
         //glm::mat4 view2 = glm::mat4(1.0f);
@@ -291,65 +383,8 @@ int main()
         
 
 
-    
-        for (int i = 0; i < count_of_particles_in_one_lawyer; ++i) {
-            for (int j = 0; j < lawyers; ++j) {
-
-                particles_locations[i][j].x += velocityX[i];
-                particles_locations[i][j].y += velocityY[i];
-                particles_locations[i][j].z += 0;
-
-
-                if (particles_locations[count_of_particles_in_one_lawyer / 2 + 1][0].x >= border   || 
-                    particles_locations[count_of_particles_in_one_lawyer / 2 + 1][0].x <= (-1) * border ||
-                    particles_locations[count_of_particles_in_one_lawyer / 2 + 1][lawyers - 1].x >= border ||
-                    particles_locations[count_of_particles_in_one_lawyer / 2 + 1][lawyers - 1].x <= (-1) * border) {
-
-                    for (int i1 = 0; i1 < count_of_particles_in_one_lawyer; i1++) {
-                        velocityX[i1] *= -1;
-                        for (int j1 = 0; j1 < lawyers; ++j1) {
-                            particles_locations[i1][j1].x += velocityX[i1];
-                        }
-                    }
-
-                }
-
-
-                if (particles_locations[count_of_particles_in_one_lawyer / 2 + 1][0].y >= border ||
-                    particles_locations[count_of_particles_in_one_lawyer / 2 + 1][0].y <= (-1) * border ||
-                    particles_locations[count_of_particles_in_one_lawyer / 2 + 1][lawyers - 1].y >= border ||
-                    particles_locations[count_of_particles_in_one_lawyer / 2 + 1][lawyers - 1].y <= (-1) * border) {
 
-                    for (int i1 = 0; i1 < count_of_particles_in_one_lawyer; i1++) {
-                        velocityX[i1] *= -1;
-                        for (int j1 = 0; j1 < lawyers; ++j1) {
-                            particles_locations[i1][j1].y += velocityX[i1];
-                        }
-                    }
 
-
-                }
-            }  
-        }
-
-    #if 0
-        for (int i = 0; i < particles_locations.size(); i++) {
-            for (int j = i + 1; j < particles_locations.size(); j++) {
-
-                float dx = particles_locations[i].x - particles_locations[j].x;
-                float dy = particles_locations[i].y - particles_locations[j].y;
-
-                if (sqrt(dx * dx + dy * dy) <= 0.05f) {
-
-                    velocityX[i] *= -1;
-                    velocityX[j] *= -1;
-                    velocityY[i] *= -1;
-                    velocityY[j] *= -1;
-                }
-            }
-
-        }
-    #endif
         //view = glm::translate(view, glm::vec3(vertices[i], vertices[i + 1], 0.0f));
         //view = glm::translate(view, glm::vec3(vertices[3], vertices[4], 0.0f));
         //unsigned int viewLoc = glGetUniformLocation(shaderProgram, "view");
@@ -378,22 +413,54 @@ int main()
   //glBindVertexArray(0); // не нужно каждый раз его отвязывать
 
  // glfw: обмен содержимым front- и back- буферов. Отслеживание событий ввода\вывода (была ли нажата/отпущена кнопка, перемещен курсор мыши и т.п.)
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        {
+            PROFILE_ZONE("capture");
+            int width, height;
+            context.framebuffer_size(&width, &height);
+            capture.frame(context.resolve(), context.time(), width, height);
+        }
+        {
+            PROFILE_ZONE("swap");
+            context.swap();
+        }
+        if (window)
+            glfwPollEvents();
+        if (context.time() >= next_report) {
+            frame_stats.print(stdout, "render frame");
+            if (profile_enabled())
+                profile_print_histogram(stdout, 5.0);
+            next_report = context.time() + 5.0;
+        }
+    }
+    simulating = false;
+    sim_thread.join();
+    if (capture.is_open()) {
+        capture.close();
+        std::cout << capture.written() << " frames captured, " << capture.dropped() << " dropped, "
+            << capture.failed() << " failed, " << capture.repeated() << " repeated" << std::endl;
+    }
+    if (const char* trace_path = profile_enabled() ? getenv("CLOTH_TRACE") : NULL) {
+        if (!profile_write_trace(trace_path))
+            std::cout << "Failed to write trace " << trace_path << std::endl;
     }
 
     // Опционально: освобождаем все ресурсы, как только они выполнили свое предназначение
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
+    renderer.release();
+    program.release();
 
-    // glfw: завершение, освобождение всех ранее задействованных GLFW-ресурсов
-    glfwTerminate();
+    // glfw: завершение, освобождение всех ранее задействованных GLFW-ресурсов (или контекста без окна)
+    context.destroy();
     return 0;
 }
 
 // Обработка всех событий ввода: запрос GLFW о нажатии/отпускании кнопки мыши в данном кадре и соответствующая обработка данных событий
 void processInput(GLFWwindow* window)
 {
+    // Без окна (CLOTH_HEADLESS) ввода нет
+    if (!window)
+        return;
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
 }
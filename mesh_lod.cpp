@@ -0,0 +1,111 @@
+#include "mesh_lod.h"
+#include <cmath>
+
+MeshLod::MeshLod() {
+    vao = 0;
+    vbo = 0;
+    bound = 0;
+    pixels_per_segment = 12.0f;
+    hysteresis = 0.2f;
+}
+
+MeshLod::~MeshLod() {
+    release();
+}
+
+void MeshLod::measure() {
+    float r2 = 0;
+    for (size_t l = 0; l < meshes.size(); ++l) {
+        const std::vector<float>& v = meshes[l].vertices;
+        for (size_t i = 0; i + 2 < v.size(); i += 3)
+            r2 = fmaxf(r2, v[i] * v[i] + v[i + 1] * v[i + 1] + v[i + 2] * v[i + 2]);
+    }
+    bound = sqrtf(r2);
+}
+
+void MeshLod::upload() {
+    if (vao)
+        glDeleteVertexArrays(1, &vao);
+    if (vbo)
+        glDeleteBuffers(1, &vbo);
+    ibo.release();
+    triangle_lists.clear();
+    line_lists.clear();
+
+    size_t floats = 0;
+    for (size_t l = 0; l < meshes.size(); ++l)
+        floats += meshes[l].vertices.size();
+
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, floats * sizeof(float), NULL, GL_STATIC_DRAW);
+
+    // levels one after another; their indices are shifted to match
+    int base = 0;
+    for (size_t l = 0; l < meshes.size(); ++l) {
+        const ParamMesh& m = meshes[l];
+        glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)base * 3 * sizeof(float), m.vertices.size() * sizeof(float), m.vertices.data());
+        triangle_lists.push_back(ibo.add(m.triangles, base));
+        line_lists.push_back(ibo.add(m.lines, base));
+        base += m.vertex_count();
+    }
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    ibo.upload(base);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    std::vector<ParamMesh>().swap(meshes);
+}
+
+void MeshLod::release() {
+    ibo.release();
+    if (vbo)
+        glDeleteBuffers(1, &vbo);
+    if (vao)
+        glDeleteVertexArrays(1, &vao);
+    vbo = 0;
+    vao = 0;
+    triangle_lists.clear();
+    line_lists.clear();
+}
+
+float MeshLod::screen_radius(float radius, float distance, float fovy, float viewport_height) {
+    if (distance <= radius)
+        return viewport_height;         // the eye is inside, fill the screen
+    return radius / (distance * tanf(0.5f * fovy)) * 0.5f * viewport_height;
+}
+
+int MeshLod::select(float screen_radius, int current) const {
+    const int n = levels();
+    if (n == 0)
+        return -1;
+    // segments needed so none is longer than pixels_per_segment on screen
+    const float needed = 6.28318531f * screen_radius / pixels_per_segment;
+    if (current >= 0 && current < n) {
+        const float low = current > 0 ? level_segments[current - 1] * (1.0f - hysteresis) : 0.0f;
+        const float high = level_segments[current] * (1.0f + hysteresis);
+        if (needed > low && (needed <= high || current == n - 1))
+            return current;
+    }
+    int level = 0;
+    while (level < n - 1 && level_segments[level] < needed)
+        ++level;
+    return level;
+}
+
+void MeshLod::draw_triangles(int level, GLenum mode) const {
+    if (level < 0 || level >= (int)triangle_lists.size())
+        return;
+    glBindVertexArray(vao);
+    ibo.draw(triangle_lists[level], mode);
+}
+
+void MeshLod::draw_lines(int level, GLenum mode) const {
+    if (level < 0 || level >= (int)line_lists.size())
+        return;
+    glBindVertexArray(vao);
+    ibo.draw(line_lists[level], mode);
+}
@@ -0,0 +1,86 @@
+#ifndef MESH_LOD_H
+#define MESH_LOD_H
+
+#include <glad/glad.h>
+#include <vector>
+#include "index_buffer.h"
+#include "param_mesh.h"
+
+// One parametric surface tessellated at several levels of detail, e.g. 8,
+// 16, 32, 64 and 128 segments, all packed into one vertex buffer and one
+// index buffer behind a single VAO. Every frame each object picks the level
+// for its size on screen:
+//
+//     int segments[] = { 8, 16, 32, 64, 128 };
+//     lod.build(SphereSurface{ 1.0f }, segments, 5, NULL, &shared_jobs());
+//     lod.upload();
+//     ...
+//     float r = MeshLod::screen_radius(lod.radius() * scale, distance, fovy, height);
+//     level = lod.select(r, level);          // level kept per object
+//     lod.draw_triangles(level);
+//
+// A level is enough when its segments are at most pixels_per_segment long
+// around the silhouette. select() only leaves the current level once the
+// size has moved hysteresis (a fraction) past the range of that level, so
+// an object hovering at a boundary does not pop between two levels.
+class MeshLod {
+public:
+    MeshLod();
+    ~MeshLod();
+
+    MeshLod(const MeshLod&) = delete;
+    MeshLod& operator=(const MeshLod&) = delete;
+
+    // Tessellates the surface at segments[0] < segments[1] < ... stacks and
+    // sectors, through the cache in cache_dir unless it is NULL; no GL calls.
+    template <class Surface>
+    void build(const Surface& surface, const int* segments, int levels,
+        const char* cache_dir = NULL, JobSystem* jobs = NULL) {
+        meshes.assign(levels, ParamMesh());
+        level_segments.assign(segments, segments + levels);
+        for (int l = 0; l < levels; ++l)
+            cached_param_mesh(surface, segments[l], segments[l], cache_dir, meshes[l], jobs);
+        measure();
+    }
+
+    // Needs a current GL 3.3 context. Creates the buffers and frees the
+    // CPU copies of the meshes.
+    void upload();
+    void release();
+
+    // Radius in pixels of a sphere of the given radius, distance from the
+    // eye, vertical field of view (radians) and viewport height.
+    static float screen_radius(float radius, float distance, float fovy, float viewport_height);
+    // Level to draw an object of the given screen radius with, given the
+    // one it was drawn with last time (-1 the first time).
+    int select(float screen_radius, int current) const;
+
+    // Draw with the caller's program in use; they bind the LOD's VAO.
+    void draw_triangles(int level, GLenum mode = GL_TRIANGLES) const;
+    void draw_lines(int level, GLenum mode = GL_LINES) const;
+
+    void set_pixels_per_segment(float pixels) { pixels_per_segment = pixels; }
+    void set_hysteresis(float fraction) { hysteresis = fraction; }
+
+    int levels() const { return (int)level_segments.size(); }
+    int segments(int level) const { return level_segments[level]; }
+    int triangle_count(int level) const { return ibo.count(triangle_lists[level]) / 3; }
+    // Largest distance of a vertex from the origin of the surface.
+    float radius() const { return bound; }
+
+private:
+    void measure();
+
+    GLuint vao;
+    GLuint vbo;
+    IndexBuffer ibo;
+    std::vector<ParamMesh> meshes;      // until upload()
+    std::vector<int> level_segments;
+    std::vector<int> triangle_lists;    // IndexBuffer list of every level
+    std::vector<int> line_lists;
+    float bound;
+    float pixels_per_segment;
+    float hysteresis;
+};
+
+#endif
@@ -0,0 +1,198 @@
+#ifndef _WIN32
+#define _DEFAULT_SOURCE // madvise
+#endif
+
+#include "asset.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+struct Asset {
+    char *path;
+    const unsigned char *data;
+    size_t size;
+    int refs;
+    Asset *next; // open assets form a list for sharing by path
+};
+
+static Asset *open_assets = NULL;
+static int open_count = 0;
+
+// data of empty files, which cannot be mapped
+static const unsigned char empty_data[1] = { 0 };
+
+#ifdef _WIN32
+
+static AssetStatus map_file(const char *path, const unsigned char **data, size_t *size) {
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        DWORD error = GetLastError();
+        return error == ERROR_FILE_NOT_FOUND || error == ERROR_PATH_NOT_FOUND
+            ? ASSET_NOT_FOUND : ASSET_IO_ERROR;
+    }
+    LARGE_INTEGER length;
+    if (!GetFileSizeEx(file, &length)) {
+        CloseHandle(file);
+        return ASSET_IO_ERROR;
+    }
+    if (length.QuadPart == 0) {
+        CloseHandle(file);
+        *data = empty_data;
+        *size = 0;
+        return ASSET_OK;
+    }
+    // the view keeps the mapping and the file alive after the handles close
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (!mapping) {
+        return ASSET_IO_ERROR;
+    }
+    void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!view) {
+        return ASSET_NO_MEMORY;
+    }
+    *data = view;
+    *size = (size_t)length.QuadPart;
+    return ASSET_OK;
+}
+
+static void unmap_file(const unsigned char *data, size_t size) {
+    (void)size;
+    UnmapViewOfFile(data);
+}
+
+#else
+
+static AssetStatus map_file(const char *path, const unsigned char **data, size_t *size) {
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        return errno == ENOENT || errno == ENOTDIR ? ASSET_NOT_FOUND : ASSET_IO_ERROR;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        close(fd);
+        return ASSET_IO_ERROR;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        *data = empty_data;
+        *size = 0;
+        return ASSET_OK;
+    }
+    // the mapping stays valid after the descriptor is closed
+    void *view = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (view == MAP_FAILED) {
+        return errno == ENOMEM ? ASSET_NO_MEMORY : ASSET_IO_ERROR;
+    }
+    // shaders and images are read front to back once
+    madvise(view, (size_t)st.st_size, MADV_SEQUENTIAL);
+    *data = view;
+    *size = (size_t)st.st_size;
+    return ASSET_OK;
+}
+
+static void unmap_file(const unsigned char *data, size_t size) {
+    munmap((void *)data, size);
+}
+
+#endif
+
+AssetStatus asset_open(const char *path, Asset **asset) {
+    *asset = NULL;
+    for (Asset *a = open_assets; a; a = a->next) {
+        if (strcmp(a->path, path) == 0) {
+            a->refs++;
+            *asset = a;
+            return ASSET_OK;
+        }
+    }
+
+    Asset *a = calloc(1, sizeof(Asset));
+    size_t len = strlen(path);
+    char *copy = malloc(len + 1);
+    if (!a || !copy) {
+        free(a);
+        free(copy);
+        return ASSET_NO_MEMORY;
+    }
+    memcpy(copy, path, len + 1);
+    AssetStatus status = map_file(path, &a->data, &a->size);
+    if (status != ASSET_OK) {
+        free(a);
+        free(copy);
+        return status;
+    }
+    a->path = copy;
+    a->refs = 1;
+    a->next = open_assets;
+    open_assets = a;
+    open_count++;
+    *asset = a;
+    return ASSET_OK;
+}
+
+void asset_retain(Asset *asset) {
+    asset->refs++;
+}
+
+void asset_release(Asset *asset) {
+    if (!asset || --asset->refs > 0) {
+        return;
+    }
+    Asset **link = &open_assets;
+    while (*link != asset) {
+        link = &(*link)->next;
+    }
+    *link = asset->next;
+    open_count--;
+    if (asset->size > 0) {
+        unmap_file(asset->data, asset->size);
+    }
+    free(asset->path);
+    free(asset);
+}
+
+const unsigned char *asset_data(const Asset *asset) {
+    return asset->data;
+}
+
+size_t asset_size(const Asset *asset) {
+    return asset->size;
+}
+
+const char *asset_path(const Asset *asset) {
+    return asset->path;
+}
+
+const char *asset_status_string(AssetStatus status) {
+    switch (status) {
+    case ASSET_OK:
+        return "ok";
+    case ASSET_NOT_FOUND:
+        return "file not found";
+    case ASSET_IO_ERROR:
+        return "read error";
+    case ASSET_NO_MEMORY:
+        return "out of memory";
+    }
+    return "unknown error";
+}
+
+int asset_open_count(void) {
+    return open_count;
+}
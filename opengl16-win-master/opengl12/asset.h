@@ -0,0 +1,44 @@
+#ifndef ASSET_H
+#define ASSET_H
+
+#include <stddef.h>
+
+// Files mapped read-only into memory. Loaders read the bytes where the
+// mapping puts them, with no heap copy: shader text goes to glShaderSource
+// with its length, images to stbi_load_from_memory.
+//
+// Assets are reference counted. Opening a path that is already open returns
+// the same mapping with one more reference, so several loaders share it;
+// the file is unmapped when the last reference is released. Open and
+// release on one thread; the bytes may be read from any while referenced.
+
+typedef enum {
+    ASSET_OK = 0,
+    ASSET_NOT_FOUND,
+    ASSET_IO_ERROR,
+    ASSET_NO_MEMORY
+} AssetStatus;
+
+typedef struct Asset Asset;
+
+// On success *asset holds a reference the caller releases; otherwise it is
+// set to NULL.
+AssetStatus asset_open(const char *path, Asset **asset);
+
+void asset_retain(Asset *asset);
+
+void asset_release(Asset *asset);
+
+// Not zero-terminated. An empty file has size 0 and a non-NULL data.
+const unsigned char *asset_data(const Asset *asset);
+
+size_t asset_size(const Asset *asset);
+
+const char *asset_path(const Asset *asset);
+
+const char *asset_status_string(AssetStatus status);
+
+// Assets open right now, to check that every loader released its own.
+int asset_open_count(void);
+
+#endif
@@ -5,12 +5,44 @@
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
+#include "asset.h"
+#include "../../job_system.h"
 
 void im_init() {
     stbi_set_flip_vertically_on_load(1);
 }
 
-GLuint im_load(const char *image_file_path) {
+typedef struct {
+    const char *path;
+    Asset *file;
+    unsigned char *data;
+    int width, height, nrChannels;
+} Image;
+
+static void decode_images(void *context, int begin, int end) {
+    Image *images = (Image *)context;
+    for (int i = begin; i < end; ++i) {
+        Image *im = &images[i];
+        if (im->file) {
+            // decoded straight from the mapped file
+            im->data = stbi_load_from_memory(asset_data(im->file), (int)asset_size(im->file),
+                &im->width, &im->height, &im->nrChannels, 0);
+        }
+    }
+}
+
+static GLuint create_texture(const Image *im) {
+    if (!im->data) {
+        if (im->file) {
+            fprintf(stderr, "Failed to load image %s: %s\n", im->path, stbi_failure_reason());
+        }
+        return 0;
+    }
+    if (im->nrChannels < 3 || im->nrChannels > 4) {
+        fprintf(stderr, "Number of channels should be 3 or 4 for %s\n", im->path);
+        return 0;
+    }
+
     GLuint texture;
     glGenTextures(1, &texture);
     glBindTexture(GL_TEXTURE_2D, texture);
@@ -18,28 +50,52 @@ GLuint im_load(const char *image_file_path) {
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    int width, height, nrChannels;
-    unsigned char *data = stbi_load(image_file_path, &width, &height, &nrChannels, 0);
-    if (!data) {
-        fprintf(stderr, "Failed to load image %s\n", image_file_path);
-        exit(EXIT_FAILURE);
-    }
-    if (nrChannels < 3 || nrChannels > 4) {
-        fprintf(stderr, "Number of channels should be 3 or 4 for %s\n", image_file_path);
-        exit(EXIT_FAILURE);
-    }
     glTexImage2D(GL_TEXTURE_2D,
                 0, // level of detail
                 GL_RGB, // result
-                width,
-                height,
+                im->width,
+                im->height,
                 0, // should be always 0
-                nrChannels == 3 ? GL_RGB : GL_RGBA, // source image
+                im->nrChannels == 3 ? GL_RGB : GL_RGBA, // source image
                 GL_UNSIGNED_BYTE,
-                data);
+                im->data);
     glGenerateMipmap(GL_TEXTURE_2D);
-    stbi_image_free(data);
     glBindTexture(GL_TEXTURE_2D, 0);
     return texture;
 }
+
+int im_load_many(const char **image_file_paths, int count, GLuint *textures) {
+    for (int i = 0; i < count; ++i)
+        textures[i] = 0;
+    Image *images = calloc(count, sizeof(Image));
+    if (!images) {
+        fprintf(stderr, "Out of memory loading %d images\n", count);
+        return 0;
+    }
+    // files are mapped here, on one thread, and only read by the jobs
+    for (int i = 0; i < count; ++i) {
+        images[i].path = image_file_paths[i];
+        AssetStatus status = asset_open(images[i].path, &images[i].file);
+        if (status != ASSET_OK)
+            fprintf(stderr, "Failed to load image %s: %s\n", images[i].path, asset_status_string(status));
+    }
+
+    // decoding is the slow part and needs no GL, so every image is a job
+    job_parallel_for(count, 1, decode_images, images);
+
+    int loaded = 0;
+    for (int i = 0; i < count; ++i) {
+        textures[i] = create_texture(&images[i]);
+        loaded += textures[i] != 0;
+        stbi_image_free(images[i].data);
+        asset_release(images[i].file);
+    }
+    free(images);
+    return loaded;
+}
+
+GLuint im_load(const char *image_file_path) {
+    GLuint texture;
+    im_load_many(&image_file_path, 1, &texture);
+    return texture;
+}
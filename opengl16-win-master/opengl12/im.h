@@ -6,6 +6,13 @@
 
 void im_init();
 
+// 0 if the file can't be read or decoded; the reason goes to stderr.
 GLuint im_load(const char *image_file_path);
 
+// Decodes count images in parallel on the job system, then creates the
+// textures on the calling thread, which owns the GL context. Images are
+// decoded from read-only mappings of the files (asset.h). Textures that
+// fail are 0; returns how many loaded.
+int im_load_many(const char **image_file_paths, int count, GLuint *textures);
+
 #endif
@@ -160,3 +160,29 @@ void m_mat4_mul(mat4 m1, mat4 m2, mat4 dest) {
     dest[3][2] = a02 * b30 + a12 * b31 + a22 * b32 + a32 * b33;
     dest[3][3] = a03 * b30 + a13 * b31 + a23 * b32 + a33 * b33;
 }
+
+// frustum
+
+void m_frustum_planes(mat4 clip, vec4 planes[6]) {
+    for (int p = 0; p < 6; p++) {
+        int row = p / 2;
+        float sign = p % 2 == 0 ? 1.0f : -1.0f;   // left/right, bottom/top, near/far
+        for (int col = 0; col < 4; col++)
+            planes[p][col] = clip[col][3] + sign * clip[col][row];
+        float len = sqrtf(planes[p][0] * planes[p][0] + planes[p][1] * planes[p][1]
+            + planes[p][2] * planes[p][2]);
+        if (len > 0.0f)
+            for (int col = 0; col < 4; col++)
+                planes[p][col] /= len;
+    }
+}
+
+int m_sphere_in_frustum(vec4 planes[6], vec3 center, float radius) {
+    for (int p = 0; p < 6; p++) {
+        float dist = planes[p][0] * center[0] + planes[p][1] * center[1]
+            + planes[p][2] * center[2] + planes[p][3];
+        if (dist < -radius)
+            return 0;
+    }
+    return 1;
+}
@@ -51,4 +51,13 @@ void m_translate_matr(float x, float y, float z, mat4 dest);
 
 void m_mat4_mul(mat4 m1, mat4 m2, mat4 dest);
 
+// frustum
+
+// Planes (a, b, c, d) of clip = projection * view (* model), inside positive
+// and normalized, so a point gives its distance to each plane.
+void m_frustum_planes(mat4 clip, vec4 planes[6]);
+
+// 0 if the sphere is entirely outside one of the planes.
+int m_sphere_in_frustum(vec4 planes[6], vec3 center, float radius);
+
 #endif
@@ -9,63 +9,68 @@
 #include "m.h"
 #include "cam.h"
 #include "im.h"
+#include "uni.h"
 
 GLuint vao;
 GLuint vbo;
 GLuint ibo;
-GLuint projectionLoc, viewLoc, viewPosLoc, lightPosLoc, lightColorLoc;
-GLuint modelLoc, texture1Loc;
+Uni uni;
+int projectionLoc, viewLoc, viewPosLoc, lightPosLoc, lightColorLoc;
+int modelLoc, texture1Loc;
 GLuint posAttr, colorAttr, normalAttr, texCoordAttr;
 
 GLuint texture1;
 
 Cam cam;
+mat4 the_projection = MAT4_IDENTITY;
 float last_frame;
 float delta_time;
 int the_w, the_h;
 
-void setUniformLocations() {
-    modelLoc = glGetUniformLocation(prog, "model");
-    viewLoc = glGetUniformLocation(prog, "view");
-    projectionLoc = glGetUniformLocation(prog, "projection");
-    viewPosLoc = glGetUniformLocation(prog, "viewPos");
-    lightPosLoc = glGetUniformLocation(prog, "lightPos");
-    lightColorLoc = glGetUniformLocation(prog, "lightColor");
-    texture1Loc = glGetUniformLocation(prog, "texture1Loc");
-
-    posAttr = glGetAttribLocation(prog, "pos");
-    colorAttr = glGetAttribLocation(prog, "color");
-    normalAttr = glGetAttribLocation(prog, "normal");
-    texCoordAttr = glGetAttribLocation(prog, "texCoord");
+int setUniformLocations() {
+    if (!uni_init(&uni, prog)) {
+        return 0;
+    }
+    modelLoc = uni_find(&uni, "model");
+    viewLoc = uni_find(&uni, "view");
+    projectionLoc = uni_find(&uni, "projection");
+    viewPosLoc = uni_find(&uni, "viewPos");
+    lightPosLoc = uni_find(&uni, "lightPos");
+    lightColorLoc = uni_find(&uni, "lightColor");
+    texture1Loc = uni_find(&uni, "texture1");
+
+    posAttr = uni_attrib(&uni, "pos");
+    colorAttr = uni_attrib(&uni, "color");
+    normalAttr = uni_attrib(&uni, "normal");
+    texCoordAttr = uni_attrib(&uni, "texCoord");
+    return 1;
 }
 
 void createBuffer();
 void initVao();
 
-void init() {
+int init() {
     createBuffer();
 
-    GLuint shaders[] = {
-        createShader("shader.vs", GL_VERTEX_SHADER),
-        createShader("shader.fs", GL_FRAGMENT_SHADER)
-    };
-    int len = sizeof(shaders) / sizeof(shaders[0]);
-    createProg(shaders, len);
-    int i = 0;
-    for (; i < len; i++) {
-        glDeleteShader(shaders[i]);
+    // SHADER_CACHE=dir keeps the linked program there for the next start
+    const char *shaderFiles[] = { "shader.vs", "shader.fs" };
+    GLenum shaderTypes[] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+    if (!createCachedProg(shaderFiles, shaderTypes, 2, getenv("SHADER_CACHE"))) {
+        return 0;
     }
 
-    setUniformLocations();
+    if (!setUniformLocations()) {
+        return 0;
+    }
 
     initVao();
 
+    // without its texture the cube draws black, which is not worth quitting
     texture1 = im_load("textures/purple-flowers.jpg");
-    glUseProgram(prog);
+    uni_use(&uni);
     glActiveTexture(GL_TEXTURE0 + 0);
     glBindTexture(GL_TEXTURE_2D, texture1);
-    glUniform1i(texture1Loc, 0);
-    glUseProgram(0);
+    uni_1i(&uni, texture1Loc, 0);
 
     glEnable(GL_DEPTH_TEST);
     glDepthMask(GL_TRUE);
@@ -75,6 +80,7 @@ void init() {
     // glEnable(GL_CULL_FACE);
     glCullFace(GL_BACK);
     glFrontFace(GL_CW);
+    return 1;
 }
 
 void createBuffer() {
@@ -341,17 +347,18 @@ void display() {
     glClearColor(0.16f, 0.03f, 0.34f, 0.0f);
     glClearDepth(1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    glUseProgram(prog);
+    // the program stays current between frames, so this is usually free
+    uni_use(&uni);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(vao);
 
-    glUniform3fv(viewPosLoc, 1, cam.eye);
-    glUniform3f(lightPosLoc, 5.0f, 5.0f, 5.0f);
-    glUniform3f(lightColorLoc, 1.0f, 1.0f, 1.0f);
+    uni_3fv(&uni, viewPosLoc, cam.eye);
+    uni_3f(&uni, lightPosLoc, 5.0f, 5.0f, 5.0f);
+    uni_3f(&uni, lightColorLoc, 1.0f, 1.0f, 1.0f);
 
     mat4 view;
     cam_view(&cam, view);
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, (GLfloat *)view);
+    uni_mat4(&uni, viewLoc, (GLfloat *)view);
 
     mat4 model = MAT4_IDENTITY;
     float scale = 5.0f;
@@ -362,12 +369,19 @@ void display() {
     mat4 trans;
     m_translate_matr(0, 0, 0, trans);
     m_mat4_mul(trans, model, model);
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, (GLfloat*)model);
-
-    glDrawElements(GL_TRIANGLES, 6*2*3, GL_UNSIGNED_SHORT, 0);
+    uni_mat4(&uni, modelLoc, (GLfloat*)model);
+
+    // skip the cube when its bounding sphere is entirely off screen
+    mat4 clip;
+    vec4 planes[6];
+    vec3 center = { 0.0f, 0.0f, 0.0f };
+    m_mat4_mul(view, model, clip);
+    m_mat4_mul(the_projection, clip, clip);
+    m_frustum_planes(clip, planes);
+    if (m_sphere_in_frustum(planes, center, 0.8660254f))   // half diagonal of the unit cube
+        glDrawElements(GL_TRIANGLES, 6*2*3, GL_UNSIGNED_SHORT, 0);
 
     glBindVertexArray(0);
-    glUseProgram(0);
     glutSwapBuffers();
     glutPostRedisplay();
 }
@@ -381,11 +395,9 @@ void reshape(int w, int h) {
     float nearVal = 0.2f;
     float farVal = 1000.0f;
 
-    mat4 projection;
-    m_perspective(fovy, aspect, nearVal, farVal, projection);
-    glUseProgram(prog);
-    glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, (GLfloat*)projection);
-    glUseProgram(0);
+    m_perspective(fovy, aspect, nearVal, farVal, the_projection);
+    uni_use(&uni);
+    uni_mat4(&uni, projectionLoc, (GLfloat*)the_projection);
     glViewport(0, 0, (GLsizei)w, (GLsizei)h);
 }
 
@@ -451,7 +463,9 @@ int main(int argc, char *argv[]) {
     glutKeyboardUpFunc(keyboard_release);
     glutMotionFunc(motion);
     glutPassiveMotionFunc(motion);
-    init();
+    if (!init()) {
+        return 1;
+    }
     glutMainLoop();
     return 0;
 }
@@ -0,0 +1,145 @@
+#include "pcache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// File: this header, then the binary.
+typedef struct {
+    char magic[8];
+    unsigned long long key;
+    unsigned int format;
+    unsigned int length;
+} PcacheHeader;
+
+static const char PCACHE_MAGIC[8] = { 'P', 'R', 'O', 'G', 'B', '0', '0', '1' };
+
+int pcache_supported(void) {
+    if (!GLEW_VERSION_4_1 && !GLEW_ARB_get_program_binary) {
+        return 0;
+    }
+    // a driver may support the calls but offer no binary format at all
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+}
+
+static void hash_bytes(unsigned long long *h, const char *s, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        *h ^= (unsigned char)s[i];
+        *h *= 1099511628211ull;
+    }
+    // and a zero byte after, so "ab" + "c" differs from "a" + "bc"
+    *h *= 1099511628211ull;
+}
+
+static void hash_string(unsigned long long *h, const char *s) {
+    hash_bytes(h, s ? s : "", s ? strlen(s) : 0);
+}
+
+unsigned long long pcache_key(const char **sources, const int *lengths, int count) {
+    unsigned long long h = 14695981039346656037ull; // FNV-1a
+    for (int i = 0; i < count; i++) {
+        if (lengths) {
+            hash_bytes(&h, sources[i], (size_t)lengths[i]);
+        } else {
+            hash_string(&h, sources[i]);
+        }
+    }
+    hash_string(&h, (const char *)glGetString(GL_VENDOR));
+    hash_string(&h, (const char *)glGetString(GL_RENDERER));
+    hash_string(&h, (const char *)glGetString(GL_VERSION));
+    return h;
+}
+
+static void make_path(const char *dir, unsigned long long key, char *path, size_t size) {
+    size_t len = strlen(dir);
+    const char *sep = len > 0 && dir[len - 1] != '/' && dir[len - 1] != '\\' ? "/" : "";
+    snprintf(path, size, "%s%sprogram_%016llx.bin", dir, sep, key);
+}
+
+GLuint pcache_load(const char *dir, unsigned long long key) {
+    char path[1024];
+    make_path(dir, key, path, sizeof(path));
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return 0;
+    }
+    PcacheHeader h;
+    char *binary = NULL;
+    int ok = fread(&h, sizeof(h), 1, f) == 1
+        && memcmp(h.magic, PCACHE_MAGIC, sizeof(h.magic)) == 0
+        && h.key == key && h.length > 0;
+    if (ok) {
+        // a truncated or corrupt file must not make us allocate its length
+        long at = ftell(f);
+        ok = fseek(f, 0, SEEK_END) == 0 && at >= 0 && ftell(f) - at >= (long)h.length
+            && fseek(f, at, SEEK_SET) == 0;
+    }
+    if (ok) {
+        binary = malloc(h.length);
+        ok = binary && fread(binary, 1, h.length, f) == h.length;
+    }
+    fclose(f);
+    if (!ok) {
+        free(binary);
+        return 0;
+    }
+
+    GLuint prog = glCreateProgram();
+    glProgramBinary(prog, (GLenum)h.format, binary, (GLsizei)h.length);
+    free(binary);
+    GLint status;
+    glGetProgramiv(prog, GL_LINK_STATUS, &status);
+    if (status == GL_FALSE) {
+        // a stale binary can also raise an error; don't leave it for
+        // whoever checks glGetError next
+        while (glGetError() != GL_NO_ERROR) {
+        }
+        glDeleteProgram(prog);
+        return 0;
+    }
+    return prog;
+}
+
+int pcache_save(const char *dir, unsigned long long key, GLuint prog) {
+    GLint length = 0;
+    glGetProgramiv(prog, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return 0;
+    }
+    char *binary = malloc(length);
+    if (!binary) {
+        return 0;
+    }
+    GLenum format = 0;
+    glGetProgramBinary(prog, length, &length, &format, binary);
+
+    PcacheHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, PCACHE_MAGIC, sizeof(h.magic));
+    h.key = key;
+    h.format = format;
+    h.length = (unsigned int)length;
+
+    // written under another name and renamed, so no reader sees half a file
+    char path[1024], tmp[1040];
+    make_path(dir, key, path, sizeof(path));
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE *f = fopen(tmp, "wb");
+    int ok = f != NULL && length > 0;
+    if (f) {
+        ok = ok && fwrite(&h, sizeof(h), 1, f) == 1
+            && fwrite(binary, 1, (size_t)length, f) == (size_t)length;
+        ok = fclose(f) == 0 && ok;
+    }
+    free(binary);
+    if (ok) {
+        remove(path); // rename does not replace files on Windows
+        ok = rename(tmp, path) == 0;
+    }
+    if (!ok) {
+        remove(tmp);
+    }
+    return ok;
+}
@@ -0,0 +1,27 @@
+#ifndef PCACHE_H
+#define PCACHE_H
+
+#include <GL/glew.h>
+#include <GL/freeglut.h>
+
+// Linked programs saved to disk as driver binaries (glGetProgramBinary), so
+// later starts skip compiling and linking the shaders. A binary is only good
+// for the driver that wrote it: the key hashes the shader sources with
+// GL_VENDOR, GL_RENDERER and GL_VERSION, and a binary the driver still
+// rejects is simply compiled again and saved over.
+
+// Needs a current context and glewInit.
+int pcache_supported(void);
+
+// Key of the program linked from sources[0..count-1] in order, lengths[i]
+// bytes each, or zero-terminated if lengths is NULL.
+unsigned long long pcache_key(const char **sources, const int *lengths, int count);
+
+// The cached program, or 0 if there is none or the driver rejects it.
+GLuint pcache_load(const char *dir, unsigned long long key);
+
+// prog must have been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set.
+// Returns 0 if nothing was saved.
+int pcache_save(const char *dir, unsigned long long key, GLuint prog);
+
+#endif
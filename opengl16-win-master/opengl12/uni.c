@@ -0,0 +1,220 @@
+#include "uni.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// glUseProgram is global state of the context, shared by every Uni.
+static GLuint current_prog = 0;
+
+static unsigned hash(const char *s) {
+    unsigned h = 2166136261u; // FNV-1a
+    for (; *s; s++) {
+        h ^= (unsigned char)*s;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// NULL if out of memory.
+static char *copy_name(const char *s, size_t len) {
+    char *res = malloc(len + 1);
+    if (!res) {
+        return NULL;
+    }
+    memcpy(res, s, len);
+    res[len] = 0;
+    return res;
+}
+
+static void insert(Uni *uni, const char *name, int index) {
+    unsigned slot = hash(name) & uni->slot_mask;
+    while (uni->slots[slot] >= 0) {
+        slot = (slot + 1) & uni->slot_mask;
+    }
+    uni->slots[slot] = index;
+}
+
+static void warn(Uni *uni, const char *what, const char *name) {
+    for (int i = 0; i < uni->warned_count; i++) {
+        if (strcmp(uni->warned[i], name) == 0) {
+            return;
+        }
+    }
+    // out of memory, the name is not remembered and warned about again
+    char *copy = copy_name(name, strlen(name));
+    char **warned = copy ? realloc(uni->warned, sizeof(char *) * (uni->warned_count + 1)) : NULL;
+    if (warned) {
+        uni->warned = warned;
+        uni->warned[uni->warned_count++] = copy;
+    } else {
+        free(copy);
+    }
+    fprintf(stderr, "Program %u has no active %s \"%s\"\n", uni->prog, what, name);
+}
+
+int uni_init(Uni *uni, GLuint prog) {
+    memset(uni, 0, sizeof(Uni));
+    uni->prog = prog;
+
+    GLint count = 0, longest = 0;
+    glGetProgramiv(prog, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(prog, GL_ACTIVE_UNIFORM_MAX_LENGTH, &longest);
+    GLint attrib_count = 0, attrib_longest = 0;
+    glGetProgramiv(prog, GL_ACTIVE_ATTRIBUTES, &attrib_count);
+    glGetProgramiv(prog, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &attrib_longest);
+    if (attrib_longest > longest) {
+        longest = attrib_longest;
+    }
+    char *name = malloc(longest + 1);
+
+    // at most half full, so probe chains stay short
+    int slot_count = 8;
+    while (slot_count < 2 * count) {
+        slot_count *= 2;
+    }
+    uni->slots = malloc(sizeof(int) * slot_count);
+    uni->vars = calloc(count > 0 ? count : 1, sizeof(UniVar));
+    uni->attribs = calloc(attrib_count > 0 ? attrib_count : 1, sizeof(UniAttrib));
+    if (!name || !uni->slots || !uni->vars || !uni->attribs) {
+        goto out_of_memory;
+    }
+    uni->slot_mask = slot_count - 1;
+    for (int i = 0; i < slot_count; i++) {
+        uni->slots[i] = -1;
+    }
+
+    for (GLint i = 0; i < count; i++) {
+        UniVar *v = &uni->vars[uni->count];
+        GLsizei len = 0;
+        glGetActiveUniform(prog, (GLuint)i, longest + 1, &len, &v->size, &v->type, name);
+        v->location = glGetUniformLocation(prog, name);
+        // members of uniform blocks have no location
+        if (v->location < 0) {
+            continue;
+        }
+        // arrays are reported as "name[0]"; "name" means the same element
+        char *bracket = strchr(name, '[');
+        if (bracket) {
+            len = (GLsizei)(bracket - name);
+        }
+        v->name = copy_name(name, len);
+        if (!v->name) {
+            goto out_of_memory;
+        }
+        insert(uni, v->name, uni->count);
+        uni->count++;
+    }
+
+    for (GLint i = 0; i < attrib_count; i++) {
+        GLsizei len = 0;
+        GLint size;
+        GLenum type;
+        glGetActiveAttrib(prog, (GLuint)i, longest + 1, &len, &size, &type, name);
+        uni->attribs[i].name = copy_name(name, len);
+        if (!uni->attribs[i].name) {
+            goto out_of_memory;
+        }
+        uni->attribs[i].location = glGetAttribLocation(prog, name);
+        uni->attrib_count++;
+    }
+    free(name);
+    return 1;
+
+out_of_memory:
+    fprintf(stderr, "Out of memory reading the uniforms of program %u\n", prog);
+    free(name);
+    uni_free(uni);
+    return 0;
+}
+
+void uni_free(Uni *uni) {
+    for (int i = 0; i < uni->count; i++) {
+        free(uni->vars[i].name);
+    }
+    for (int i = 0; i < uni->attrib_count; i++) {
+        free(uni->attribs[i].name);
+    }
+    for (int i = 0; i < uni->warned_count; i++) {
+        free(uni->warned[i]);
+    }
+    free(uni->vars);
+    free(uni->slots);
+    free(uni->attribs);
+    free(uni->warned);
+    memset(uni, 0, sizeof(Uni));
+}
+
+int uni_find(Uni *uni, const char *name) {
+    if (uni->slots) {
+        unsigned slot = hash(name) & uni->slot_mask;
+        while (uni->slots[slot] >= 0) {
+            int i = uni->slots[slot];
+            if (strcmp(uni->vars[i].name, name) == 0) {
+                return i;
+            }
+            slot = (slot + 1) & uni->slot_mask;
+        }
+    }
+    warn(uni, "uniform", name);
+    return -1;
+}
+
+// A program has a handful of attributes, looked up once at init.
+GLint uni_attrib(Uni *uni, const char *name) {
+    for (int i = 0; i < uni->attrib_count; i++) {
+        if (strcmp(uni->attribs[i].name, name) == 0) {
+            return uni->attribs[i].location;
+        }
+    }
+    warn(uni, "attribute", name);
+    return -1;
+}
+
+void uni_use(Uni *uni) {
+    if (current_prog != uni->prog) {
+        glUseProgram(uni->prog);
+        current_prog = uni->prog;
+    }
+}
+
+void uni_forget_current() {
+    current_prog = 0;
+}
+
+// Compares and stores the raw bits, so ints and floats share the cache.
+static int changed(Uni *uni, int i, const void *v, int n) {
+    UniVar *var = &uni->vars[i];
+    if (var->known && memcmp(var->value, v, n * sizeof(float)) == 0) {
+        uni->skipped++;
+        return 0;
+    }
+    memcpy(var->value, v, n * sizeof(float));
+    var->known = 1;
+    return 1;
+}
+
+void uni_1i(Uni *uni, int i, GLint v) {
+    if (i >= 0 && changed(uni, i, &v, 1)) {
+        glUniform1i(uni->vars[i].location, v);
+    }
+}
+
+void uni_3f(Uni *uni, int i, float x, float y, float z) {
+    float v[3] = { x, y, z };
+    if (i >= 0 && changed(uni, i, v, 3)) {
+        glUniform3f(uni->vars[i].location, x, y, z);
+    }
+}
+
+void uni_3fv(Uni *uni, int i, const float *v) {
+    if (i >= 0 && changed(uni, i, v, 3)) {
+        glUniform3fv(uni->vars[i].location, 1, v);
+    }
+}
+
+void uni_mat4(Uni *uni, int i, const float *m) {
+    if (i >= 0 && changed(uni, i, m, 16)) {
+        glUniformMatrix4fv(uni->vars[i].location, 1, GL_FALSE, m);
+    }
+}
@@ -0,0 +1,67 @@
+#ifndef UNI_H
+#define UNI_H
+
+#include <GL/glew.h>
+#include <GL/freeglut.h>
+
+// Active uniforms and attributes of a linked program, read back once after
+// linking into a hash table, so nothing asks the driver for a location while
+// drawing. Uniforms are addressed by the index uni_find returns.
+//
+// The setters remember the last value of every uniform and skip the
+// glUniform* call when it is the same. They write to the current program:
+// call uni_use first. uni_use skips glUseProgram when the program is already
+// current; after calling glUseProgram directly, call uni_forget_current.
+
+typedef struct {
+    char *name;
+    GLint location;
+    GLenum type;
+    GLint size;
+    int known; // value holds what the program has
+    float value[16];
+} UniVar;
+
+typedef struct {
+    char *name;
+    GLint location;
+} UniAttrib;
+
+typedef struct {
+    GLuint prog;
+    UniVar *vars;
+    int count;
+    int *slots; // open addressing, index into vars or -1
+    int slot_mask;
+    UniAttrib *attribs;
+    int attrib_count;
+    char **warned;
+    int warned_count;
+    long skipped; // redundant uploads skipped so far
+} Uni;
+
+// 0 if out of memory, with uni left empty.
+int uni_init(Uni *uni, GLuint prog);
+
+void uni_free(Uni *uni);
+
+// Index of an active uniform for the setters, or -1 with a warning the first
+// time a name is not in the program. The setters ignore -1.
+int uni_find(Uni *uni, const char *name);
+
+// Location of an active attribute, or -1 with a warning.
+GLint uni_attrib(Uni *uni, const char *name);
+
+void uni_use(Uni *uni);
+
+void uni_forget_current();
+
+void uni_1i(Uni *uni, int i, GLint v);
+
+void uni_3f(Uni *uni, int i, float x, float y, float z);
+
+void uni_3fv(Uni *uni, int i, const float *v);
+
+void uni_mat4(Uni *uni, int i, const float *m);
+
+#endif
@@ -1,64 +1,34 @@
 #include "util.h"
+#include "asset.h"
+#include "pcache.h"
 #include <stdio.h>
+#include <stdlib.h>
 
 GLuint prog;
 
-char *readFile(const char *fileName) {
-    FILE *f = fopen(fileName, "rb");
-    if (!f) {
-        perror("fopen failed");
-        exit(1);
-    }
-    if (fseek(f, 0, SEEK_END) == -1) {
-        perror("fseek failed");
-        exit(1);
-    }
-    long len = ftell(f);
-    if (len == -1) {
-        perror("ftell failed");
-        exit(1);
-    }
-    if (fseek(f, 0, SEEK_SET) == -1) {
-        perror("fseek failed");
-        exit(1);
-    }
-    char *res = malloc(len + 1);
-    if (!res) {
-        fprintf(stderr, "malloc failed\n");
-        exit(1);
-    }
-    if (fread(res, 1, len, f) != (size_t)len) {
-        fprintf(stderr, "fread failed for file %s\n", fileName);
-        exit(1);
-    }
-    if (fclose(f) == EOF) {
-        perror("fclose failed");
-        exit(1);
-    }
-    res[len] = 0;
-    return res;
-}
-
-GLuint createShader(const char *shaderFile, GLenum shaderType) {
-    const char *strShaderType;
+static const char *shaderTypeName(GLenum shaderType) {
     if (shaderType == GL_VERTEX_SHADER) {
-        strShaderType = "vertex";
+        return "vertex";
     } else if (shaderType == GL_GEOMETRY_SHADER) {
-        strShaderType = "geometry";
+        return "geometry";
     } else if (shaderType == GL_FRAGMENT_SHADER) {
-        strShaderType = "fragment";
-    } else {
+        return "fragment";
+    }
+    return NULL;
+}
+
+GLuint compileShader(const char *source, GLint length, GLenum shaderType) {
+    const char *strShaderType = shaderTypeName(shaderType);
+    if (!strShaderType) {
         fprintf(stderr, "Unrecognized shader type\n");
-        exit(1);
+        return 0;
     }
     GLuint shader = glCreateShader(shaderType);
     if (!shader) {
         fprintf(stderr, "Error creating shader of type %s\n", strShaderType);
-        exit(1);
+        return 0;
     }
-    GLchar *content = readFile(shaderFile);
-    glShaderSource(shader, 1, (const GLchar **)&content, NULL);
-    free(content);
+    glShaderSource(shader, 1, (const GLchar **)&source, &length);
     glCompileShader(shader);
     GLint status;
     glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
@@ -66,23 +36,43 @@ GLuint createShader(const char *shaderFile, GLenum shaderType) {
         GLint infoLen;
         glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &infoLen);
         GLchar *info = malloc(sizeof(GLchar) * (infoLen + 1));
-        glGetShaderInfoLog(shader, infoLen, NULL, info);
-        fprintf(stderr, "Compile failure in %s shader:\n%s\n", strShaderType, info);
-        exit(1);
+        if (info) {
+            glGetShaderInfoLog(shader, infoLen, NULL, info);
+            fprintf(stderr, "Compile failure in %s shader:\n%s\n", strShaderType, info);
+            free(info);
+        }
+        glDeleteShader(shader);
+        return 0;
     }
     return shader;
 }
 
-void createProg(GLuint *shaders, int len) {
+GLuint createShader(const char *shaderFile, GLenum shaderType) {
+    Asset *file;
+    AssetStatus status = asset_open(shaderFile, &file);
+    if (status != ASSET_OK) {
+        fprintf(stderr, "Can't read %s: %s\n", shaderFile, asset_status_string(status));
+        return 0;
+    }
+    // straight from the mapping, the driver copies what it needs
+    GLuint shader = compileShader((const char *)asset_data(file), (GLint)asset_size(file), shaderType);
+    asset_release(file);
+    return shader;
+}
+
+int createProg(GLuint *shaders, int len) {
     int i = 0;
     prog = glCreateProgram();
     if (!prog) {
         fprintf(stderr, "Failed to create shader program\n");
-        exit(1);
+        return 0;
     }
     for (; i < len; i++) {
         glAttachShader(prog, shaders[i]);
     }
+    if (pcache_supported()) {
+        glProgramParameteri(prog, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
     glLinkProgram(prog);
     GLint status;
     glGetProgramiv(prog, GL_LINK_STATUS, &status);
@@ -90,9 +80,67 @@ void createProg(GLuint *shaders, int len) {
         GLint infoLen;
         glGetProgramiv(prog, GL_INFO_LOG_LENGTH, &infoLen);
         GLchar *info = malloc(sizeof(GLchar) * (infoLen + 1));
-        glGetProgramInfoLog(prog, infoLen, NULL, info);
-        fprintf(stderr, "Linker failure: %s\n", info);
-        exit(1);
+        if (info) {
+            glGetProgramInfoLog(prog, infoLen, NULL, info);
+            fprintf(stderr, "Linker failure: %s\n", info);
+            free(info);
+        }
+        glDeleteProgram(prog);
+        prog = 0;
+        return 0;
     }
+    return 1;
 }
 
+int createCachedProg(const char **shaderFiles, const GLenum *shaderTypes, int len, const char *cacheDir) {
+    Asset **files = calloc(len, sizeof(Asset *));
+    const char **sources = malloc(sizeof(char *) * len);
+    int *lengths = malloc(sizeof(int) * len);
+    GLuint *shaders = calloc(len, sizeof(GLuint));
+    int ok = files && sources && lengths && shaders;
+    if (!ok) {
+        fprintf(stderr, "malloc failed\n");
+    }
+    for (int i = 0; ok && i < len; i++) {
+        AssetStatus status = asset_open(shaderFiles[i], &files[i]);
+        if (status != ASSET_OK) {
+            fprintf(stderr, "Can't read %s: %s\n", shaderFiles[i], asset_status_string(status));
+            ok = 0;
+            break;
+        }
+        sources[i] = (const char *)asset_data(files[i]);
+        lengths[i] = (int)asset_size(files[i]);
+    }
+
+    prog = 0;
+    int cached = ok && cacheDir && pcache_supported();
+    unsigned long long key = 0;
+    if (cached) {
+        key = pcache_key(sources, lengths, len);
+        prog = pcache_load(cacheDir, key);
+    }
+    if (ok && !prog) {
+        for (int i = 0; ok && i < len; i++) {
+            shaders[i] = compileShader(sources[i], lengths[i], shaderTypes[i]);
+            ok = shaders[i] != 0;
+        }
+        ok = ok && createProg(shaders, len);
+        if (ok && cached) {
+            pcache_save(cacheDir, key, prog);
+        }
+    }
+
+    for (int i = 0; i < len; i++) {
+        if (shaders) {
+            glDeleteShader(shaders[i]);
+        }
+        if (files) {
+            asset_release(files[i]);
+        }
+    }
+    free(files);
+    free(sources);
+    free(lengths);
+    free(shaders);
+    return ok;
+}
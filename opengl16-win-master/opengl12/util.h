@@ -6,10 +6,22 @@
 
 extern GLuint prog;
 
-char *readFile(const char *fileName);
+// Shader and program creation print what went wrong to stderr and return 0
+// (no shader, or failure) instead of exiting, so the caller can decide.
 
+// length -1 reads the source up to its zero terminator.
+GLuint compileShader(const char *source, GLint length, GLenum shaderType);
+
+// Compiles the file straight from its read-only mapping, see asset.h.
 GLuint createShader(const char *shaderFile, GLenum shaderType);
 
-void createProg(GLuint *shaders, int len);
+// Links the shaders into prog; returns 0 and leaves prog 0 on failure.
+int createProg(GLuint *shaders, int len);
+
+// Sets prog to the program linked from the shader files. With a cacheDir the
+// program is saved there as a driver binary (see pcache.h) and later starts
+// load it instead of compiling, as long as the files are unchanged. Returns
+// 0 if a file can't be read or the shaders don't compile or link.
+int createCachedProg(const char **shaderFiles, const GLenum *shaderTypes, int len, const char *cacheDir);
 
 #endif
@@ -0,0 +1,210 @@
+#include "param_mesh.h"
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+void param_samples(float begin, float end, int count, std::vector<ParamSample>& samples) {
+    samples.resize(count + 1);
+    const float step = (end - begin) / count;
+    for (int i = 0; i <= count; ++i) {
+        const float t = begin + i * step;
+        samples[i].t = t;
+        samples[i].c = cosf(t);
+        samples[i].s = sinf(t);
+    }
+}
+
+// Triangles and lines of stack i, per sector (see param_grid).
+static int stack_triangles(int i, int stacks, bool poles) {
+    return poles ? (i != 0) + (i != stacks - 1) : 2;
+}
+
+static int stack_lines(int i, bool poles) {
+    return poles && i == 0 ? 1 : 2;
+}
+
+// Index counts param_grid makes for the grid.
+static void param_grid_sizes(int stacks, int sectors, bool poles, bool closed, size_t& triangles, size_t& lines) {
+    triangles = 0;
+    lines = !poles && !closed ? 2 * (size_t)sectors : 0;
+    for (int i = 0; i < stacks; ++i) {
+        triangles += 3 * (size_t)stack_triangles(i, stacks, poles) * sectors;
+        lines += 2 * (size_t)stack_lines(i, poles) * sectors;
+    }
+}
+
+void param_grid(int stacks, int sectors, bool poles, bool closed, ParamMesh& mesh, JobSystem* jobs) {
+    mesh.stacks = stacks;
+    mesh.sectors = sectors;
+    mesh.vertices.resize(3 * (size_t)(stacks + 1) * (sectors + 1));
+
+    // indices
+    //  k1--k1+1
+    //  |  / |
+    //  | /  |
+    //  k2--k2+1
+    // 2 triangles and 2 lines (down and right) per sector. At poles the
+    // first and last stacks have one triangle per sector and the first
+    // stack has no horizontal lines. Every triangle starts at the corner
+    // off the k2--k1+1 diagonal, see ParamMesh. Offsets of every stack
+    // come first, so stacks can be written in parallel straight to their
+    // final place.
+    std::vector<size_t> tri_start(stacks + 1), line_start(stacks + 1);
+    tri_start[0] = 0;
+    line_start[0] = 0;
+    for (int i = 0; i < stacks; ++i) {
+        tri_start[i + 1] = tri_start[i] + 3 * (size_t)stack_triangles(i, stacks, poles) * sectors;
+        line_start[i + 1] = line_start[i] + 2 * (size_t)stack_lines(i, poles) * sectors;
+    }
+    const bool last_row = !poles && !closed;
+    mesh.triangles.resize(tri_start[stacks]);
+    mesh.lines.resize(line_start[stacks] + (last_row ? 2 * (size_t)sectors : 0));
+
+    parallel_for(jobs, stacks, 8, [&](int begin, int end) {
+        for (int i = begin; i < end; ++i) {
+            int k1 = i * (sectors + 1);     // beginning of current stack
+            int k2 = k1 + sectors + 1;      // beginning of next stack
+            int* tri = &mesh.triangles[0] + tri_start[i];
+            int* line = &mesh.lines[0] + line_start[i];
+            const bool top = poles && i == 0;
+            const bool bottom = poles && i == stacks - 1;
+
+            for (int j = 0; j < sectors; ++j, ++k1, ++k2) {
+                if (!top) {
+                    *tri++ = k1;
+                    *tri++ = k2;
+                    *tri++ = k1 + 1;
+                }
+                if (!bottom) {
+                    *tri++ = k2 + 1;
+                    *tri++ = k1 + 1;
+                    *tri++ = k2;
+                }
+
+                *line++ = k1;
+                *line++ = k2;
+                if (!top) {
+                    *line++ = k1;
+                    *line++ = k1 + 1;
+                }
+            }
+        }
+    });
+
+    if (last_row) {
+        int* line = &mesh.lines[0] + line_start[stacks];
+        const int k = stacks * (sectors + 1);
+        for (int j = 0; j < sectors; ++j) {
+            *line++ = k + j;
+            *line++ = k + j + 1;
+        }
+    }
+}
+
+// Cache file: this header, then the vertices, triangles and lines arrays
+// as stored in memory.
+struct ParamCacheHeader {
+    char magic[8];
+    char name[16];
+    float params[4];
+    int32_t stacks;
+    int32_t sectors;
+    uint64_t vertices;          // floats
+    uint64_t triangles;         // ints
+    uint64_t lines;             // ints
+};
+
+static const char PARAM_CACHE_MAGIC[8] = { 'P', 'M', 'E', 'S', 'H', '0', '0', '2' };
+
+static void fill_key(ParamCacheHeader& h, const char* name, const float params[4], int stacks, int sectors) {
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, PARAM_CACHE_MAGIC, sizeof(h.magic));
+    strncpy(h.name, name, sizeof(h.name) - 1);
+    memcpy(h.params, params, sizeof(h.params));
+    h.stacks = stacks;
+    h.sectors = sectors;
+}
+
+std::string param_cache_path(const char* cache_dir, const char* name, const float params[4], int stacks, int sectors) {
+    uint32_t hash = 2166136261u;        // FNV-1a over the parameter bits
+    const unsigned char* bytes = (const unsigned char*)params;
+    for (size_t i = 0; i < 4 * sizeof(float); ++i) {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    char file[96];
+    snprintf(file, sizeof(file), "%s_%dx%d_%08x.mesh", name, stacks, sectors, (unsigned)hash);
+    std::string path = cache_dir;
+    if (!path.empty() && path[path.size() - 1] != '/' && path[path.size() - 1] != '\\')
+        path += '/';
+    return path + file;
+}
+
+// True if every index is below count.
+static bool indices_below(const std::vector<int>& indices, int count) {
+    for (int k : indices)
+        if (k < 0 || k >= count)
+            return false;
+    return true;
+}
+
+bool load_param_mesh(const std::string& path, const char* name, const float params[4], int stacks, int sectors,
+    bool poles, bool closed, ParamMesh& mesh) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f)
+        return false;
+    ParamCacheHeader key, h;
+    fill_key(key, name, params, stacks, sectors);
+    size_t triangles, lines;
+    param_grid_sizes(stacks, sectors, poles, closed, triangles, lines);
+    bool ok = fread(&h, sizeof(h), 1, f) == 1
+        && memcmp(h.magic, key.magic, sizeof(h.magic)) == 0
+        && memcmp(h.name, key.name, sizeof(h.name)) == 0
+        && memcmp(h.params, key.params, sizeof(h.params)) == 0
+        && h.stacks == key.stacks && h.sectors == key.sectors
+        && h.vertices == 3 * (uint64_t)(h.stacks + 1) * (h.sectors + 1)
+        && h.triangles == triangles && h.lines == lines;
+    if (ok) {
+        mesh.stacks = h.stacks;
+        mesh.sectors = h.sectors;
+        mesh.vertices.resize((size_t)h.vertices);
+        mesh.triangles.resize((size_t)h.triangles);
+        mesh.lines.resize((size_t)h.lines);
+        ok = fread(mesh.vertices.data(), sizeof(float), mesh.vertices.size(), f) == mesh.vertices.size()
+            && fread(mesh.triangles.data(), sizeof(int), mesh.triangles.size(), f) == mesh.triangles.size()
+            && fread(mesh.lines.data(), sizeof(int), mesh.lines.size(), f) == mesh.lines.size();
+    }
+    // the indices go to the GPU as they are
+    const int vertices = (stacks + 1) * (sectors + 1);
+    ok = ok && indices_below(mesh.triangles, vertices) && indices_below(mesh.lines, vertices);
+    fclose(f);
+    return ok;
+}
+
+bool save_param_mesh(const std::string& path, const char* name, const float params[4], const ParamMesh& mesh) {
+    ParamCacheHeader h;
+    fill_key(h, name, params, mesh.stacks, mesh.sectors);
+    h.vertices = mesh.vertices.size();
+    h.triangles = mesh.triangles.size();
+    h.lines = mesh.lines.size();
+
+    // written under another name and renamed, so a reader never sees half
+    // a file, even from a process running at the same time
+    const std::string tmp = path + ".tmp";
+    FILE* f = fopen(tmp.c_str(), "wb");
+    if (!f)
+        return false;
+    bool ok = fwrite(&h, sizeof(h), 1, f) == 1
+        && fwrite(mesh.vertices.data(), sizeof(float), mesh.vertices.size(), f) == mesh.vertices.size()
+        && fwrite(mesh.triangles.data(), sizeof(int), mesh.triangles.size(), f) == mesh.triangles.size()
+        && fwrite(mesh.lines.data(), sizeof(int), mesh.lines.size(), f) == mesh.lines.size();
+    ok = fclose(f) == 0 && ok;
+    if (ok) {
+        remove(path.c_str());       // rename does not replace files on Windows
+        ok = rename(tmp.c_str(), path.c_str()) == 0;
+    }
+    if (!ok)
+        remove(tmp.c_str());
+    return ok;
+}
@@ -0,0 +1,180 @@
+#ifndef PARAM_MESH_H
+#define PARAM_MESH_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "job_system.h"
+
+// Parametric surface sampled on a grid of (stacks + 1) x (sectors + 1)
+// vertices: stack i is the i-th value of the surface's u parameter, sector j
+// the j-th value of v. The last sector repeats the first one on closed
+// surfaces, so every vertex row is a full strip for texture coordinates.
+struct ParamMesh {
+    int stacks = 0;
+    int sectors = 0;
+    std::vector<float> vertices;    // x, y, z
+    // 3 vertex indices each. The two edges from the first vertex of a
+    // triangle are grid edges; the third is a quad diagonal, or at a pole a
+    // grid edge the neighbouring triangle has from its first vertex. So the
+    // edges from first vertices alone draw the grid, see wireframe.h.
+    std::vector<int> triangles;
+    std::vector<int> lines;         // 2 vertex indices each, the grid edges
+
+    int vertex_count() const { return (int)(vertices.size() / 3); }
+};
+
+// One value of a surface parameter. Angles come with their cosine and sine
+// from a table built once per mesh, so a surface evaluates no trigonometry
+// per vertex: (stacks + 1) + (sectors + 1) cos/sin pairs instead of
+// (stacks + 1) * (sectors + 1).
+struct ParamSample {
+    float t;
+    float c;            // cos(t)
+    float s;            // sin(t)
+};
+
+// A surface is a small struct with
+//     name()                  unique per surface type, part of the cache key
+//     params(float out[4])    its dimensions, the rest of the cache key
+//     u_range(), v_range()    parameter intervals over stacks and sectors
+//     poles()                 true if the first and last stack collapse to
+//                             a point, which then gets one triangle per
+//                             sector instead of two
+//     closed()                true if the last stack lands on the first
+//                             one, whose lines then are not drawn twice;
+//                             otherwise the last stack gets its own lines
+//     point(u, v, out)        x, y, z of the surface at (u, v)
+
+// Stacks from the north pole (+z) to the south, sectors around the z axis.
+struct SphereSurface {
+    float radius;
+
+    static const char* name() { return "sphere"; }
+    void params(float out[4]) const { out[0] = radius; out[1] = out[2] = out[3] = 0; }
+    static void u_range(float& begin, float& end) { begin = 1.57079633f; end = -1.57079633f; }
+    static void v_range(float& begin, float& end) { begin = 0; end = 6.28318531f; }
+    static bool poles() { return true; }
+    static bool closed() { return false; }
+    void point(const ParamSample& u, const ParamSample& v, float* out) const {
+        const float xy = radius * u.c;
+        out[0] = xy * v.c;
+        out[1] = xy * v.s;
+        out[2] = radius * u.s;
+    }
+};
+
+// Ring of radius major around the z axis with a tube of radius minor;
+// stacks go around the tube starting from its inner side.
+struct TorusSurface {
+    float major;
+    float minor;
+
+    static const char* name() { return "torus"; }
+    void params(float out[4]) const { out[0] = major; out[1] = minor; out[2] = out[3] = 0; }
+    static void u_range(float& begin, float& end) { begin = -3.14159265f; end = 3.14159265f; }
+    static void v_range(float& begin, float& end) { begin = 0; end = 6.28318531f; }
+    static bool poles() { return false; }
+    static bool closed() { return true; }
+    void point(const ParamSample& u, const ParamSample& v, float* out) const {
+        const float xy = major + minor * u.c;
+        out[0] = xy * v.c;
+        out[1] = xy * v.s;
+        out[2] = minor * u.s;
+    }
+};
+
+// width x height rectangle in the XY plane centred on the origin; stacks go
+// down from the top edge, sectors to the right from the left edge.
+struct PlaneSurface {
+    float width;
+    float height;
+
+    static const char* name() { return "plane"; }
+    void params(float out[4]) const { out[0] = width; out[1] = height; out[2] = out[3] = 0; }
+    static void u_range(float& begin, float& end) { begin = 0; end = 1; }
+    static void v_range(float& begin, float& end) { begin = 0; end = 1; }
+    static bool poles() { return false; }
+    static bool closed() { return false; }
+    void point(const ParamSample& u, const ParamSample& v, float* out) const {
+        out[0] = (v.t - 0.5f) * width;
+        out[1] = (0.5f - u.t) * height;
+        out[2] = 0;
+    }
+};
+
+// Open tube around the z axis from z = height / 2 down to -height / 2.
+struct CylinderSurface {
+    float radius;
+    float height;
+
+    static const char* name() { return "cylinder"; }
+    void params(float out[4]) const { out[0] = radius; out[1] = height; out[2] = out[3] = 0; }
+    static void u_range(float& begin, float& end) { begin = 0; end = 1; }
+    static void v_range(float& begin, float& end) { begin = 0; end = 6.28318531f; }
+    static bool poles() { return false; }
+    static bool closed() { return false; }
+    void point(const ParamSample& u, const ParamSample& v, float* out) const {
+        out[0] = radius * v.c;
+        out[1] = radius * v.s;
+        out[2] = (0.5f - u.t) * height;
+    }
+};
+
+// count + 1 evenly spaced values from begin to end.
+void param_samples(float begin, float end, int count, std::vector<ParamSample>& samples);
+
+// Sizes mesh for a stacks x sectors grid and fills in the triangles and
+// lines; the vertices are left for the surface.
+void param_grid(int stacks, int sectors, bool poles, bool closed, ParamMesh& mesh, JobSystem* jobs = NULL);
+
+// File name for a mesh in cache_dir, derived from everything that affects
+// its contents.
+std::string param_cache_path(const char* cache_dir, const char* name, const float params[4], int stacks, int sectors);
+// Return false if the file is missing, unreadable or made for other
+// parameters or another grid (the key is stored in the file and compared),
+// or if its index counts or indices do not fit that grid.
+bool load_param_mesh(const std::string& path, const char* name, const float params[4], int stacks, int sectors,
+    bool poles, bool closed, ParamMesh& mesh);
+bool save_param_mesh(const std::string& path, const char* name, const float params[4], const ParamMesh& mesh);
+
+// Samples the surface on a stacks x sectors grid. Rows of vertices and of
+// indices are split between the threads of jobs.
+template <class Surface>
+void generate_param_mesh(const Surface& surface, int stacks, int sectors, ParamMesh& mesh, JobSystem* jobs = NULL) {
+    std::vector<ParamSample> us, vs;
+    float begin, end;
+    surface.u_range(begin, end);
+    param_samples(begin, end, stacks, us);
+    surface.v_range(begin, end);
+    param_samples(begin, end, sectors, vs);
+
+    param_grid(stacks, sectors, surface.poles(), surface.closed(), mesh, jobs);
+    parallel_for(jobs, stacks + 1, 8, [&](int first, int last) {
+        for (int i = first; i < last; ++i) {
+            float* out = &mesh.vertices[3 * (size_t)i * (sectors + 1)];
+            for (int j = 0; j <= sectors; ++j, out += 3)
+                surface.point(us[i], vs[j], out);
+        }
+    });
+}
+
+// Same, but reads the mesh from cache_dir if an earlier run saved it there,
+// and saves it otherwise. A NULL cache_dir disables the cache.
+template <class Surface>
+void cached_param_mesh(const Surface& surface, int stacks, int sectors, const char* cache_dir,
+    ParamMesh& mesh, JobSystem* jobs = NULL) {
+    if (!cache_dir) {
+        generate_param_mesh(surface, stacks, sectors, mesh, jobs);
+        return;
+    }
+    float params[4];
+    surface.params(params);
+    const std::string path = param_cache_path(cache_dir, surface.name(), params, stacks, sectors);
+    if (load_param_mesh(path, surface.name(), params, stacks, sectors, surface.poles(), surface.closed(), mesh))
+        return;
+    generate_param_mesh(surface, stacks, sectors, mesh, jobs);
+    save_param_mesh(path, surface.name(), params, mesh);
+}
+
+#endif
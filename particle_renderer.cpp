@@ -0,0 +1,95 @@
+#include "particle_renderer.h"
+#include <cstddef>
+#include <cstring>
+
+ParticleRenderer::ParticleRenderer() {
+    vao = 0;
+    mapped_count = 0;
+    mesh_vertices = 0;
+    mode = GL_TRIANGLES;
+}
+
+ParticleRenderer::~ParticleRenderer() {
+    release();
+}
+
+void ParticleRenderer::init(GLuint mesh_vbo, GLsizei mesh_vertices, GLenum mode) {
+    release();
+    this->mesh_vertices = mesh_vertices;
+    this->mode = mode;
+
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh_vbo);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    for (GLuint a = 1; a <= 3; ++a) {
+        glEnableVertexAttribArray(a);
+        glVertexAttribDivisor(a, 1);
+    }
+    glBindVertexArray(0);
+}
+
+void ParticleRenderer::release() {
+    instances.release();
+    if (vao)
+        glDeleteVertexArrays(1, &vao);
+    vao = 0;
+    mapped_count = 0;
+}
+
+// The ring only ever grows, with some slack so a slowly growing particle
+// count does not reallocate it every frame.
+void ParticleRenderer::reserve(GLsizeiptr bytes) {
+    if (bytes > instances.region_size())
+        instances.init(bytes + bytes / 2);
+}
+
+float* ParticleRenderer::map(int count) {
+    if (!vao || count <= 0)
+        return NULL;
+    reserve((GLsizeiptr)count * 3 * sizeof(float));
+    mapped_count = count;
+    return (float*)instances.map();
+}
+
+void ParticleRenderer::draw_mapped() {
+    if (!mapped_count)
+        return;
+    draw_instances(mapped_count, false);
+    mapped_count = 0;
+}
+
+void ParticleRenderer::draw(const float* x, const float* y, const float* z, int count) {
+    float* dst = map(count);
+    if (!dst)
+        return;
+    memcpy(dst, x, count * sizeof(float));
+    memcpy(dst + count, y, count * sizeof(float));
+    memcpy(dst + 2 * count, z, count * sizeof(float));
+    draw_mapped();
+}
+
+void ParticleRenderer::draw(const float* xyz, int count) {
+    float* dst = map(count);
+    if (!dst)
+        return;
+    memcpy(dst, xyz, (size_t)count * 3 * sizeof(float));
+    draw_instances(count, true);
+    mapped_count = 0;
+}
+
+void ParticleRenderer::draw_instances(int count, bool interleaved) {
+    const GLintptr offset = instances.unmap();
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, instances.id());
+    // x, y, z of one particle are 4 bytes apart, or whole arrays apart
+    const GLsizei stride = interleaved ? 3 * sizeof(float) : sizeof(float);
+    const GLintptr next = interleaved ? sizeof(float) : count * sizeof(float);
+    glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, stride, (void*)offset);
+    glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, stride, (void*)(offset + next));
+    glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, stride, (void*)(offset + 2 * next));
+    glDrawArraysInstanced(mode, 0, mesh_vertices, count);
+    instances.fence();
+    glBindVertexArray(0);
+}
@@ -0,0 +1,65 @@
+#ifndef PARTICLE_RENDERER_H
+#define PARTICLE_RENDERER_H
+
+#include <glad/glad.h>
+#include "stream_buffer.h"
+
+// Draws the same small mesh at every particle with one instanced draw call.
+// The particle positions go to a streaming instance buffer once per frame
+// and reach the vertex shader as three float attributes, one instance
+// apart; the shader adds them to the mesh vertex:
+//
+//     layout (location = 0) in vec3 aPos;
+//     layout (location = 1) in float aX;
+//     layout (location = 2) in float aY;
+//     layout (location = 3) in float aZ;
+//     ...
+//     gl_Position = vec4(aPos + vec3(aX, aY, aZ), 1.0);
+//
+// Separate float attributes let the same shader read both separate x, y, z
+// arrays and interleaved xyz without copying either into another layout.
+//
+// The instance data goes through a StreamBuffer: every frame writes a fresh
+// region of a ring while the GPU may still draw from the previous ones, so
+// the CPU never waits for it. The CPU cost per frame is one write of the
+// positions and a handful of GL calls however many particles there are;
+// map()/draw_mapped() skip even the copy by letting the caller produce the
+// positions in the buffer itself.
+class ParticleRenderer {
+public:
+    ParticleRenderer();
+    ~ParticleRenderer();
+
+    ParticleRenderer(const ParticleRenderer&) = delete;
+    ParticleRenderer& operator=(const ParticleRenderer&) = delete;
+
+    // Needs a current GL 3.3 context. mesh_vbo holds mesh_vertices x, y, z
+    // floats drawn with mode (GL_TRIANGLES, GL_LINE_LOOP, ...); the buffer
+    // stays owned by the caller.
+    void init(GLuint mesh_vbo, GLsizei mesh_vertices, GLenum mode);
+    void release();
+
+    // All draw with whatever program the caller has in use.
+    // Positions as separate arrays, e.g. ClothParticles.
+    void draw(const float* x, const float* y, const float* z, int count);
+    // Interleaved x, y, z, e.g. std::vector<glm::vec3>.
+    void draw(const float* xyz, int count);
+
+    // Room for count particles in the instance buffer, laid out as count
+    // x values, then count y values, then count z values. Write-only: it
+    // is mapped GPU memory. draw_mapped() then draws them.
+    float* map(int count);
+    void draw_mapped();
+
+private:
+    void reserve(GLsizeiptr bytes);
+    void draw_instances(int count, bool interleaved);
+
+    GLuint vao;
+    StreamBuffer instances;
+    int mapped_count;
+    GLsizei mesh_vertices;
+    GLenum mode;
+};
+
+#endif
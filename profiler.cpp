@@ -0,0 +1,207 @@
+#include "profiler.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdarg>
+#include <map>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PROFILE_TSC
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+static int64_t steady_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int64_t profile_now() {
+#ifdef PROFILE_TSC
+    return (int64_t)__rdtsc();
+#else
+    return steady_ns();
+#endif
+}
+
+// Both clocks at start-up; the tick rate of the counter is measured against
+// steady_clock over the whole run whenever ticks are turned into time.
+struct ClockOrigin {
+    int64_t ticks;
+    int64_t ns;
+};
+
+static const ClockOrigin origin = { profile_now(), steady_ns() };
+
+static double ticks_per_us() {
+#ifdef PROFILE_TSC
+    const int64_t ticks = profile_now() - origin.ticks;
+    const int64_t ns = steady_ns() - origin.ns;
+    return ns > 0 && ticks > 0 ? ticks * 1000.0 / ns : 1000.0;
+#else
+    return 1000.0;
+#endif
+}
+
+struct ProfileEvent {
+    const char* name;
+    int64_t start;
+    int64_t end;
+};
+
+// Ring of one thread. Only that thread writes to it; written is published
+// after the event so readers never see a half-written one unless the ring
+// has wrapped around under them.
+struct ProfileThread {
+    ProfileEvent events[PROFILE_RING];
+    std::atomic<uint64_t> written;
+    int id;
+    char name[32];
+    ProfileThread* next;
+};
+
+// Rings are never freed, so the zones of threads that have finished are
+// still in the trace. New rings are pushed on the front of the list.
+static std::atomic<ProfileThread*> threads(NULL);
+static std::atomic<int> thread_count(0);
+static thread_local ProfileThread* current = NULL;
+
+static ProfileThread* this_thread() {
+    if (!current) {
+        ProfileThread* t = new ProfileThread;
+        t->written = 0;
+        t->id = thread_count++;
+        snprintf(t->name, sizeof(t->name), "thread %d", t->id);
+        t->next = threads.load();
+        while (!threads.compare_exchange_weak(t->next, t))
+            ;
+        current = t;
+    }
+    return current;
+}
+
+void profile_record(const char* name, int64_t start, int64_t end) {
+    ProfileThread* t = this_thread();
+    const uint64_t w = t->written.load(std::memory_order_relaxed);
+    ProfileEvent& e = t->events[w & (PROFILE_RING - 1)];
+    e.name = name;
+    e.start = start;
+    e.end = end;
+    t->written.store(w + 1, std::memory_order_release);
+}
+
+void profile_thread_name(const char* format, ...) {
+    ProfileThread* t = this_thread();
+    va_list args;
+    va_start(args, format);
+    vsnprintf(t->name, sizeof(t->name), format, args);
+    va_end(args);
+}
+
+bool profile_enabled() {
+#ifdef CLOTH_PROFILE
+    return true;
+#else
+    return false;
+#endif
+}
+
+// Calls fn(thread, event) for every event still in the rings, oldest first
+// per thread.
+template <class Fn>
+static void for_each_event(Fn fn) {
+    for (ProfileThread* t = threads.load(); t; t = t->next) {
+        const uint64_t w = t->written.load(std::memory_order_acquire);
+        const uint64_t first = w > (uint64_t)PROFILE_RING ? w - PROFILE_RING : 0;
+        for (uint64_t i = first; i < w; ++i)
+            fn(*t, t->events[i & (PROFILE_RING - 1)]);
+    }
+}
+
+static const int BUCKETS = 17;          // 1 us, 2 us, ... 64 ms and longer
+
+void profile_print_histogram(FILE* out, double window_seconds) {
+    if (!profile_enabled())
+        return;
+    const double per_us = ticks_per_us();
+    const int64_t since = window_seconds > 0
+        ? profile_now() - (int64_t)(window_seconds * 1e6 * per_us) : INT64_MIN;
+
+    std::map<std::string, std::vector<double>> zones;
+    for_each_event([&](const ProfileThread&, const ProfileEvent& e) {
+        if (e.end >= since)
+            zones[e.name].push_back((e.end - e.start) / per_us);
+    });
+
+    fprintf(out, "%-20s %8s %10s %10s %10s %10s  1us %*s\n",
+        "zone", "count", "mean us", "p50 us", "p99 us", "max us", BUCKETS - 4, "64ms");
+    for (auto& zone : zones) {
+        std::vector<double>& d = zone.second;
+        std::sort(d.begin(), d.end());
+        double sum = 0;
+        int histogram[BUCKETS] = {};
+        for (double us : d) {
+            sum += us;
+            int b = us < 1.0 ? 0 : (int)log2(us);
+            ++histogram[std::min(b, BUCKETS - 1)];
+        }
+        const int peak = *std::max_element(histogram, histogram + BUCKETS);
+        // one character per bucket, darker for more zones
+        static const char shades[] = " .:-=+*#%@";
+        char bar[BUCKETS + 1];
+        for (int b = 0; b < BUCKETS; ++b) {
+            int shade = histogram[b] == 0 ? 0 : 1 + (int)((double)histogram[b] / peak * 8.0);
+            bar[b] = shades[std::min(shade, 9)];
+        }
+        bar[BUCKETS] = 0;
+        const size_t n = d.size();
+        fprintf(out, "%-20s %8zu %10.1f %10.1f %10.1f %10.1f  %s\n", zone.first.c_str(), n,
+            sum / n, d[n / 2], d[std::min(n - 1, n * 99 / 100)], d[n - 1], bar);
+    }
+}
+
+static void write_json_string(FILE* f, const char* s) {
+    fputc('"', f);
+    for (; *s; ++s) {
+        if (*s == '"' || *s == '\\')
+            fputc('\\', f);
+        if ((unsigned char)*s >= 0x20)
+            fputc(*s, f);
+    }
+    fputc('"', f);
+}
+
+bool profile_write_trace(const char* path) {
+    if (!profile_enabled())
+        return false;
+    FILE* f = fopen(path, "w");
+    if (!f)
+        return false;
+    const double per_us = ticks_per_us();
+
+    // complete ("X") events with start and duration in microseconds, and
+    // one metadata ("M") event naming each thread
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+    for (ProfileThread* t = threads.load(); t; t = t->next) {
+        fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":",
+            first ? "" : ",\n", t->id);
+        write_json_string(f, t->name);
+        fprintf(f, "}}");
+        first = false;
+    }
+    for_each_event([&](const ProfileThread& t, const ProfileEvent& e) {
+        fprintf(f, ",\n{\"name\":");
+        write_json_string(f, e.name);
+        fprintf(f, ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d}",
+            (e.start - origin.ticks) / per_us, (e.end - e.start) / per_us, t.id);
+    });
+    fprintf(f, "\n]}\n");
+    return fclose(f) == 0;
+}
@@ -0,0 +1,79 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <cstdint>
+#include <cstdio>
+
+// Scoped timing zones for the hot paths. A zone measures from its line to
+// the end of the enclosing block:
+//
+//     void ClothSolver::step(float dt) {
+//         PROFILE_ZONE("step");
+//         ...
+//     }
+//     ...
+//     profile_print_histogram(stdout, 5.0);     // phases of the last 5 s
+//     profile_write_trace("trace.json");        // for chrome://tracing
+//
+// Zones only exist in builds with CLOTH_PROFILE defined; otherwise the
+// macros expand to nothing and the functions below do nothing, so the
+// zones can stay in the code for good.
+//
+// Every thread writes its zones to a ring buffer of its own, which keeps
+// the last PROFILE_RING of them, without any locking. Reading the rings
+// (histogram and trace) is only exact while the other threads are not
+// recording, e.g. between frames when the job system's threads are idle.
+
+#define PROFILE_CONCAT2(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT2(a, b)
+
+#ifdef CLOTH_PROFILE
+// name must outlive the program: a string literal.
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profile_zone_, __LINE__)(name)
+#define PROFILE_THREAD(...) profile_thread_name(__VA_ARGS__)
+#else
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_THREAD(...) ((void)0)
+#endif
+
+// Zones kept per thread.
+const int PROFILE_RING = 1 << 16;
+
+// Ticks of the profiling clock: the time stamp counter on x86, nanoseconds
+// of std::chrono::steady_clock elsewhere.
+int64_t profile_now();
+void profile_record(const char* name, int64_t start, int64_t end);
+// Names the calling thread in the trace, printf style, e.g.
+// PROFILE_THREAD("worker %d", index). Unnamed threads are "thread <n>".
+void profile_thread_name(const char* format, ...);
+
+class ProfileZone {
+public:
+    explicit ProfileZone(const char* name) {
+        this->name = name;
+        start = profile_now();
+    }
+    ~ProfileZone() { profile_record(name, start, profile_now()); }
+
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+
+private:
+    const char* name;
+    int64_t start;
+};
+
+// True in builds with CLOTH_PROFILE.
+bool profile_enabled();
+
+// Count, mean, median, 99th percentile and maximum of every zone name that
+// ended within the last window_seconds (0: everything still in the rings),
+// with a log2 histogram of the durations from 1 us to 64 ms.
+void profile_print_histogram(FILE* out, double window_seconds);
+
+// Writes all zones still in the rings as Chrome trace_event JSON, to be
+// opened in chrome://tracing or ui.perfetto.dev. False if the file cannot
+// be written or profiling is compiled out.
+bool profile_write_trace(const char* path);
+
+#endif
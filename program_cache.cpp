@@ -0,0 +1,161 @@
+#include "program_cache.h"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+bool program_binary_supported() {
+#ifdef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    bool supported = major > 4 || (major == 4 && minor >= 1);
+    if (!supported) {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count && !supported; ++i) {
+            const char* name = (const char*)glGetStringi(GL_EXTENSIONS, (GLuint)i);
+            supported = name && strcmp(name, "GL_ARB_get_program_binary") == 0;
+        }
+    }
+    // a driver may support the calls but offer no binary format at all
+    GLint formats = 0;
+    if (supported)
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    // the loader may not have the entry points even if the driver has them
+    return formats > 0 && glGetProgramBinary != NULL && glProgramBinary != NULL
+        && glProgramParameteri != NULL;
+#else
+    return false;
+#endif
+}
+
+static void hash_bytes(uint64_t& hash, const void* data, size_t size) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+}
+
+static void hash_string(uint64_t& hash, const char* s) {
+    // the terminating zero too, so "ab" + "c" differs from "a" + "bc"
+    if (s)
+        hash_bytes(hash, s, strlen(s) + 1);
+    else
+        hash_bytes(hash, "", 1);
+}
+
+uint64_t program_cache_key(const char* const* sources, int count) {
+    uint64_t hash = 14695981039346656037ull;    // FNV-1a
+    for (int i = 0; i < count; ++i)
+        hash_string(hash, sources[i]);
+    hash_string(hash, (const char*)glGetString(GL_VENDOR));
+    hash_string(hash, (const char*)glGetString(GL_RENDERER));
+    hash_string(hash, (const char*)glGetString(GL_VERSION));
+    return hash;
+}
+
+std::string program_cache_path(const char* cache_dir, uint64_t key) {
+    char file[64];
+    snprintf(file, sizeof(file), "program_%016llx.bin", (unsigned long long)key);
+    std::string path = cache_dir;
+    if (!path.empty() && path[path.size() - 1] != '/' && path[path.size() - 1] != '\\')
+        path += '/';
+    return path + file;
+}
+
+// Cache file: this header, then the binary.
+struct ProgramCacheHeader {
+    char magic[8];
+    uint64_t key;
+    uint32_t format;
+    uint32_t length;
+};
+
+static const char PROGRAM_CACHE_MAGIC[8] = { 'P', 'R', 'O', 'G', 'B', '0', '0', '1' };
+
+GLuint load_program_binary(const std::string& path, uint64_t key) {
+#ifdef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f)
+        return 0;
+    ProgramCacheHeader h;
+    std::vector<char> binary;
+    bool ok = fread(&h, sizeof(h), 1, f) == 1
+        && memcmp(h.magic, PROGRAM_CACHE_MAGIC, sizeof(h.magic)) == 0
+        && h.key == key && h.length > 0;
+    if (ok) {
+        // a truncated or corrupt file must not make us allocate its length
+        long at = ftell(f);
+        ok = fseek(f, 0, SEEK_END) == 0 && at >= 0 && ftell(f) - at >= (long)h.length
+            && fseek(f, at, SEEK_SET) == 0;
+    }
+    if (ok) {
+        binary.resize(h.length);
+        ok = fread(binary.data(), 1, binary.size(), f) == binary.size();
+    }
+    fclose(f);
+    if (!ok)
+        return 0;
+
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, (GLenum)h.format, binary.data(), (GLsizei)binary.size());
+    GLint success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        // a stale binary can also raise an error; don't leave it for
+        // whoever checks glGetError next
+        while (glGetError() != GL_NO_ERROR) {
+        }
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+#else
+    (void)path;
+    (void)key;
+    return 0;
+#endif
+}
+
+bool save_program_binary(const std::string& path, uint64_t key, GLuint program) {
+#ifdef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return false;
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &length, &format, binary.data());
+    if (length <= 0)
+        return false;
+
+    ProgramCacheHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, PROGRAM_CACHE_MAGIC, sizeof(h.magic));
+    h.key = key;
+    h.format = format;
+    h.length = (uint32_t)length;
+
+    // written under another name and renamed, like the mesh cache
+    const std::string tmp = path + ".tmp";
+    FILE* f = fopen(tmp.c_str(), "wb");
+    if (!f)
+        return false;
+    bool ok = fwrite(&h, sizeof(h), 1, f) == 1
+        && fwrite(binary.data(), 1, (size_t)length, f) == (size_t)length;
+    ok = fclose(f) == 0 && ok;
+    if (ok) {
+        remove(path.c_str());       // rename does not replace files on Windows
+        ok = rename(tmp.c_str(), path.c_str()) == 0;
+    }
+    if (!ok)
+        remove(tmp.c_str());
+    return ok;
+#else
+    (void)path;
+    (void)key;
+    (void)program;
+    return false;
+#endif
+}
@@ -0,0 +1,33 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <string>
+
+// On-disk cache of linked programs as driver binaries (glGetProgramBinary,
+// GL 4.1 or ARB_get_program_binary), so later runs skip compiling and
+// linking, which dominates start-up on software GL. ShaderProgram::build
+// uses it when given a cache directory.
+//
+// A binary is only good for the driver that wrote it, so the key hashes the
+// shader sources together with GL_VENDOR, GL_RENDERER and GL_VERSION. A
+// driver can still reject a binary it wrote (after an update that kept its
+// version string, say); load_program_binary then returns 0 and the caller
+// compiles from source and saves over it.
+
+// Needs a current context.
+bool program_binary_supported();
+// Key of the program linked from sources[0..count-1] in order; a NULL entry
+// (no geometry shader) counts as an empty one. Needs a current context.
+uint64_t program_cache_key(const char* const* sources, int count);
+std::string program_cache_path(const char* cache_dir, uint64_t key);
+
+// A linked program, or 0 if there is no file, it was written under another
+// key, or the driver rejects the binary.
+GLuint load_program_binary(const std::string& path, uint64_t key);
+// The program must have been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+// set. False if the driver has no binary for it or the file cannot be written.
+bool save_program_binary(const std::string& path, uint64_t key, GLuint program);
+
+#endif
@@ -6,6 +6,10 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include <iostream>
+#include <cstdlib>
+
+#include "shader_program.h"
+#include "gl_context.h"
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void processInput(GLFWwindow* window);
@@ -37,74 +41,27 @@ const char* fragmentShaderSource = "#version 330 core\n"
 
 int main()
 {
-    glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-    glfwWindowHint(GLFW_SAMPLES, 8);
-
-#ifdef __APPLE__
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-#endif
-
-    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "OpenGL Cloth Simulation", NULL, NULL);
-    if (window == NULL)
-    {
-        std::cout << "Failed to create GLFW window" << std::endl;
-        glfwTerminate();
+    // Окно GLFW или, если задана CLOTH_HEADLESS, контекст без окна, который
+    // рисует во внеэкранный буфер кадра (см. gl_context.h)
+    GlContext context;
+    if (!context.create(SCR_WIDTH, SCR_HEIGHT, "OpenGL Cloth Simulation", 8))
         return -1;
-    }
-    glfwMakeContextCurrent(window);
-    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    GLFWwindow* window = context.window();
+    // Без окна функциям GLFW нечего передать: окно NULL, а GLFW не инициализирован
+    if (window) {
+        glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 
-    // Сообщаем GLFW, чтобы он захватил наш курсор 
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
-    {
-        std::cout << "Failed to initialize GLAD" << std::endl;
-        return -1;
+        // Сообщаем GLFW, чтобы он захватил наш курсор
+        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
     }
 
     // Конфигурирование глобального состояния OpenGL
     glEnable(GL_DEPTH_TEST);
 
-    int vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-    glCompileShader(vertexShader);
-
-    int success;
-    char infoLog[512];
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-    if (!success)
-    {
-        glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
-    }
-
-    int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-    glCompileShader(fragmentShader);
-
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-    if (!success)
-    {
-        glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
-    }
-
-    int shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-    if (!success) {
-        glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
-    }
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+    // SHADER_CACHE=папка сохраняет собранную программу в двоичном виде, и
+    // следующие запуски не компилируют шейдеры
+    ShaderProgram program;
+    program.build(vertexShaderSource, NULL, fragmentShaderSource, getenv("SHADER_CACHE"));
 
     float vertices[] = {
         -0.5f, -0.5f, -0.5f,
@@ -172,7 +129,14 @@ int main()
 
 
 
-    while (!glfwWindowShouldClose(window))
+    // Местоположения uniform-переменных получаем один раз, а не в каждом кадре;
+    // повторные одинаковые значения ShaderProgram в драйвер не отправляет
+    int modelLoc = program.uniform("model");
+    int viewLoc = program.uniform("view");
+    int projectionLoc = program.uniform("projection");
+    int vertexColorLocation = program.uniform("ourColor");
+
+    while (!context.should_close())
     {
         glEnable(GL_MULTISAMPLE);
 
@@ -180,7 +144,7 @@ int main()
 
         glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); // очищаем буфер цвета и буфер глубины
-        glUseProgram(shaderProgram);
+        program.use();
 
         glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 
@@ -188,46 +152,47 @@ int main()
         glm::mat4 model = glm::mat4(1.0f); // сначала инициализируем единичную матрицу
         glm::mat4 view = glm::mat4(1.0f);
         glm::mat4 projection = glm::mat4(1.0f);
-        model = glm::rotate(model, (float)glfwGetTime() * glm::radians(50.0f), glm::vec3(0.5f, 1.0f, 0.0f));
+        model = glm::rotate(model, (float)context.time() * glm::radians(50.0f), glm::vec3(0.5f, 1.0f, 0.0f));
         view = glm::translate(view, glm::vec3(0.0f, 0.0f, -3.0f));
         projection = glm::perspective(glm::radians(45.0f), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
 
-        // Получаем местоположение uniform-матриц...
-         unsigned int modelLoc = glGetUniformLocation(shaderProgram, "model");
-         unsigned int viewLoc = glGetUniformLocation(shaderProgram, "view");
-        // ...передаем их в шейдеры (разными способами)
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-        glUniformMatrix4fv(viewLoc, 1, GL_FALSE, &view[0][0]);
+        // Передаем матрицы в шейдеры
+        program.set_mat4(modelLoc, glm::value_ptr(model));
+        program.set_mat4(viewLoc, &view[0][0]);
 
-        glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, &projection[0][0]);
+        program.set_mat4(projectionLoc, &projection[0][0]);
 
-        float timeValue = glfwGetTime();
+        float timeValue = context.time();
         float greenValue = sin(timeValue) / 2.0f + 0.5f;
         float redValue = cos(timeValue) / 2.0f + 0.5f;
         float blueValue = cos(timeValue + 2) / 2.0f + 0.5f;
-        int vertexColorLocation = glGetUniformLocation(shaderProgram, "ourColor");
-        glUniform4f(vertexColorLocation, redValue, greenValue, blueValue, 1.0f);
+        program.set(vertexColorLocation, redValue, greenValue, blueValue, 1.0f);
 
         glBindVertexArray(VAO);
 
         glDrawArrays(GL_TRIANGLES, 0, 36);
-        glUniform4f(vertexColorLocation, 0, 0, 0, 1.0f);
+        program.set(vertexColorLocation, 0, 0, 0, 1.0f);
         glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
         glDrawArrays(GL_LINE_LOOP, 0, 36);
 
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        context.swap();
+        if (window)
+            glfwPollEvents();
     }
 
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
+    program.release();
 
-    glfwTerminate();
+    context.destroy();
     return 0;
 }
 
 void processInput(GLFWwindow* window)
 {
+    // Без окна (CLOTH_HEADLESS) ввода нет
+    if (!window)
+        return;
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
 }
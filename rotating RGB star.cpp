@@ -6,6 +6,10 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include <iostream>
+#include <cstdlib>
+
+#include "shader_program.h"
+#include "gl_context.h"
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void processInput(GLFWwindow* window);
@@ -34,67 +38,20 @@ const char* fragmentShaderSource = "#version 330 core\n"
 
 int main()
 {
-    glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-#ifdef __APPLE__
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE); 
-#endif
-
-    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "OpenGL Cloth Simulation", NULL, NULL);
-    if (window == NULL)
-    {
-        std::cout << "Failed to create GLFW window" << std::endl;
-        glfwTerminate();
+    // A GLFW window or, with CLOTH_HEADLESS set, a context without a window
+    // drawing into an offscreen framebuffer (see gl_context.h)
+    GlContext context;
+    if (!context.create(SCR_WIDTH, SCR_HEIGHT, "OpenGL Cloth Simulation"))
         return -1;
-    }
-    glfwMakeContextCurrent(window);
-    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
-    {
-        std::cout << "Failed to initialize GLAD" << std::endl;
-        return -1;
-    }
+    GLFWwindow* window = context.window();
+    // Without a window there is nothing to pass to GLFW: window is NULL and GLFW is not initialised
+    if (window)
+        glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 
-    int vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-    glCompileShader(vertexShader);
-
-    int success;
-    char infoLog[512];
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-    if (!success)
-    {
-        glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
-    }
-
-    int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-    glCompileShader(fragmentShader);
-
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-    if (!success)
-    {
-        glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
-    }
-
-    int shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-    if (!success) {
-        glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
-    }
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+    // SHADER_CACHE=dir keeps the linked program there as a binary, so later
+    // runs skip compiling the shaders
+    ShaderProgram program;
+    program.build(vertexShaderSource, NULL, fragmentShaderSource, getenv("SHADER_CACHE"));
 
     float vertices[] = {
 
@@ -153,7 +110,12 @@ int main()
     //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
     
-    while (!glfwWindowShouldClose(window))
+    // Look the uniforms up once, not every frame; ShaderProgram also skips
+    // uploading a value the program already has
+    int transformLoc = program.uniform("transform");
+    int vertexColorLocation = program.uniform("ourColor");
+
+    while (!context.should_close())
     {
         processInput(window);
 
@@ -163,18 +125,16 @@ int main()
         
         glm::mat4 transform = glm::mat4(1.0f);
         transform = glm::translate(transform, glm::vec3(0.0f, 0.0f, 0.0f));
-        transform = glm::rotate(transform, (float)glfwGetTime(), glm::vec3(0.0f, 1.0f, 0.0f));
+        transform = glm::rotate(transform, (float)context.time(), glm::vec3(0.0f, 1.0f, 0.0f));
 
-        glUseProgram(shaderProgram);
-        unsigned int transformLoc = glGetUniformLocation(shaderProgram, "transform");
-        glUniformMatrix4fv(transformLoc, 1, GL_FALSE, glm::value_ptr(transform));
+        program.use();
+        program.set_mat4(transformLoc, glm::value_ptr(transform));
 
-        float timeValue = glfwGetTime();
+        float timeValue = context.time();
         float greenValue = sin(timeValue) / 2.0f + 0.5f;
         float redValue = cos(timeValue) / 2.0f + 0.5f;
         float blueValue = cos(timeValue + 2) / 2.0f + 0.5f;
-        int vertexColorLocation = glGetUniformLocation(shaderProgram, "ourColor");
-        glUniform4f(vertexColorLocation, redValue, greenValue, blueValue, 1.0f);
+        program.set(vertexColorLocation, redValue, greenValue, blueValue, 1.0f);
 
         glBindVertexArray(VAO);
 
@@ -187,19 +147,24 @@ int main()
         glDrawArrays(GL_TRIANGLES, 12, 3);
         glDrawArrays(GL_TRIANGLE_FAN, 15, 5);
      
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        context.swap();
+        if (window)
+            glfwPollEvents();
     }
 
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
+    program.release();
 
-    glfwTerminate();
+    context.destroy();
     return 0;
 }
 
 void processInput(GLFWwindow* window)
 {
+    // no window, no input (CLOTH_HEADLESS)
+    if (!window)
+        return;
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
 }
@@ -9,19 +9,19 @@
 #include <vector>
 
 #include <cmath>
-#define PI 3.14159265358979323846
+#include <cstdlib>
+
+#include "job_system.h"
+#include "shader_program.h"
+#include "mesh_lod.h"
+#include "frustum.h"
+#include "wireframe.h"
+#include "gl_context.h"
 
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void processInput(GLFWwindow* window);
 
-std::vector <float> vertices(1);
-std::vector<int> indices(1);
-std::vector<int> lineIndices(1);
-
-void generateVertices(std::vector <float>& vertices, std::vector <int>& indices, std::vector <int>& lineIndices,
-    float radius, int sectorCount, int stackCount);
-
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
 
@@ -38,109 +38,55 @@ const char* vertexShaderSource = "#version 330 core\n"
 "   vertexColor = vec4(0.5, 0.0, 0.0, 1.0);\n"
 "}\0";
 
-const char* fragmentShaderSource = "#version 330 core\n"
-"out vec4 FragColor;\n"
-"uniform vec4 ourColor;\n"
-"void main()\n"
-"{\n"
-"   FragColor = ourColor;\n"
-"}\n\0";
-
 
 int main()
 {
-    vertices.clear();
-    indices.clear();
-    lineIndices.clear();
-    glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-    glfwWindowHint(GLFW_SAMPLES, 8);
-
-#ifdef __APPLE__
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-#endif
-
-    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "OpenGL Cloth Simulation", NULL, NULL);
-    if (window == NULL)
-    {
-        std::cout << "Failed to create GLFW window" << std::endl;
-        glfwTerminate();
+    // Окно GLFW или, если задана CLOTH_HEADLESS, контекст без окна, который
+    // рисует во внеэкранный буфер кадра (см. gl_context.h)
+    GlContext context;
+    if (!context.create(SCR_WIDTH, SCR_HEIGHT, "OpenGL Cloth Simulation", 8))
         return -1;
-    }
-    glfwMakeContextCurrent(window);
-    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-
-    // Сообщаем GLFW, чтобы он захватил наш курсор 
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    GLFWwindow* window = context.window();
+    // Без окна функциям GLFW нечего передать: окно NULL, а GLFW не инициализирован
+    if (window) {
+        glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
-    {
-        std::cout << "Failed to initialize GLAD" << std::endl;
-        return -1;
+        // Сообщаем GLFW, чтобы он захватил наш курсор
+        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
     }
 
     // Конфигурирование глобального состояния OpenGL
     glEnable(GL_DEPTH_TEST);
 
-    int vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-    glCompileShader(vertexShader);
-
-    int success;
-    char infoLog[512];
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-    if (!success)
-    {
-        glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
-    }
-
-    int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-    glCompileShader(fragmentShader);
-
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-    if (!success)
-    {
-        glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
-    }
-
-    int shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-    if (!success) {
-        glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
-    }
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
-
-    generateVertices(vertices, indices, lineIndices, 1, 100, 100);
-
-    unsigned int VBO, VAO;
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-
-    glBindVertexArray(VAO);
-
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), &vertices[0], GL_STATIC_DRAW);
-
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-    glBindVertexArray(0);
-
-
-    while (!glfwWindowShouldClose(window))
+    // Заливка и рёбра рисуются за один проход: геометрический шейдер даёт
+    // фрагменту расстояние до рёбер треугольника в пикселях
+    // SHADER_CACHE=папка сохраняет собранную программу в двоичном виде, и
+    // следующие запуски не компилируют шейдеры
+    ShaderProgram program;
+    program.build(vertexShaderSource, wireframe_geometry_source, wireframe_fragment_source,
+        getenv("SHADER_CACHE"));
+
+    // Сфера построена с несколькими уровнями детализации (8-128 сегментов), в
+    // каждом кадре рисуется уровень по размеру на экране. MESH_CACHE=папка
+    // сохраняет сетки на диск, и следующие запуски читают готовые
+    MeshLod lod;
+    SphereSurface sphere = { 1.0f };
+    int segments[] = { 8, 16, 32, 64, 128 };
+    lod.build(sphere, segments, 5, getenv("MESH_CACHE"), &shared_jobs());
+    lod.upload();
+    int level = -1;
+
+    // Местоположения uniform-переменных получаем один раз, а не в каждом кадре;
+    // повторные одинаковые значения ShaderProgram в драйвер не отправляет
+    int modelLoc = program.uniform("model");
+    int viewLoc = program.uniform("view");
+    int projectionLoc = program.uniform("projection");
+    int vertexColorLocation = program.uniform("fillColor");
+    int wireColorLoc = program.uniform("wireColor");
+    int wireWidthLoc = program.uniform("wireWidth");
+    int viewportLoc = program.uniform("viewport");
+
+    while (!context.should_close())
     {
 
         glEnable(GL_MULTISAMPLE);
@@ -149,7 +95,7 @@ int main()
 
         glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); // очищаем буфер цвета и буфер глубины
-        glUseProgram(shaderProgram);
+        program.use();
 
         //uncomment it if you want to draw polygon as a frame 
         //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
@@ -159,116 +105,58 @@ int main()
         glm::mat4 model = glm::mat4(1.0f); // сначала инициализируем единичную матрицу
         glm::mat4 view = glm::mat4(1.0f);
         glm::mat4 projection = glm::mat4(1.0f);
-        model = glm::rotate(model, (float)glfwGetTime() * glm::radians(50.0f), glm::vec3(0.5f, 1.0f, 0.0f));
+        model = glm::rotate(model, (float)context.time() * glm::radians(50.0f), glm::vec3(0.5f, 1.0f, 0.0f));
         view = glm::translate(view, glm::vec3(0.0f, 0.0f, -3.0f));
         projection = glm::perspective(glm::radians(45.0f), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
 
-        // Получаем местоположение uniform-матриц...
-        unsigned int modelLoc = glGetUniformLocation(shaderProgram, "model");
-        unsigned int viewLoc = glGetUniformLocation(shaderProgram, "view");
-        // ...передаем их в шейдеры (разными способами)
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-        glUniformMatrix4fv(viewLoc, 1, GL_FALSE, &view[0][0]);
+        // Передаем матрицы в шейдеры
+        program.set_mat4(modelLoc, glm::value_ptr(model));
+        program.set_mat4(viewLoc, &view[0][0]);
 
-        glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, &projection[0][0]);
+        program.set_mat4(projectionLoc, &projection[0][0]);
 
-        float timeValue = glfwGetTime();
+        float timeValue = context.time();
         float greenValue = sin(timeValue) / 2.0f + 0.5f;
         float redValue = cos(timeValue) / 2.0f + 0.5f;
         float blueValue = cos(timeValue + 2) / 2.0f + 0.5f;
-        int vertexColorLocation = glGetUniformLocation(shaderProgram, "ourColor");
-        glUniform4f(vertexColorLocation, redValue, greenValue, blueValue, 1.0f);
-
-        glBindVertexArray(VAO);
-
-        glDrawElements(GL_TRIANGLE_FAN, (unsigned int)lineIndices.size(), GL_UNSIGNED_INT, lineIndices.data());
-        glDrawElements(GL_TRIANGLE_FAN, (unsigned int)indices.size(), GL_UNSIGNED_INT, indices.data());
-
-        glUniform4f(vertexColorLocation, 0, 0, 0, 1.0f);
-        glDrawElements(GL_LINE_LOOP, (unsigned int)lineIndices.size(), GL_UNSIGNED_INT, lineIndices.data());
+        program.set(vertexColorLocation, redValue, greenValue, blueValue, 1.0f);
+
+        // Камера на расстоянии 3 от центра
+        int width, height;
+        context.framebuffer_size(&width, &height);
+        float screenRadius = MeshLod::screen_radius(lod.radius(), 3.0f, glm::radians(45.0f), (float)height);
+        level = lod.select(screenRadius, level);
+
+        // Объект целиком вне пирамиды видимости не рисуется вовсе
+        glm::mat4 clip = projection * view * model;
+        Frustum frustum;
+        frustum.extract(glm::value_ptr(clip));
+        if (frustum.sphere_visible(0.0f, 0.0f, 0.0f, lod.radius())) {
+            // Чёрные рёбра шириной в полтора пикселя поверх заливки, один вызов
+            program.set(viewportLoc, (float)width, (float)height);
+            program.set(wireColorLoc, 0, 0, 0, 1.0f);
+            program.set(wireWidthLoc, 1.5f);
+            lod.draw_triangles(level);
+        }
 
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        context.swap();
+        if (window)
+            glfwPollEvents();
     }
 
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(1, &VBO);
+    lod.release();
+    program.release();
 
-    glfwTerminate();
+    context.destroy();
     return 0;
 }
 
-void generateVertices(std::vector <float>& vertices, std::vector <int>& indices, std::vector <int>& lineIndices,
-    float radius, int sectorCount, int stackCount) {
-
-    float x, y, z, xy;                              // vertex position
-
-    float sectorStep = 2 * PI / sectorCount;
-    float stackStep = PI / stackCount;
-    float sectorAngle, stackAngle;
-
-    for (int i = 0; i <= stackCount; ++i)
-    {
-        stackAngle = PI / 2 - i * stackStep;        // starting from pi/2 to -pi/2
-        xy = radius * cosf(stackAngle);             // r * cos(u)
-        z = radius * sinf(stackAngle);              // r * sin(u)
-
-        // add (sectorCount+1) vertices per stack
-        // the first and last vertices have same position and normal, but different tex coords
-        for (int j = 0; j <= sectorCount; ++j)
-        {
-            sectorAngle = j * sectorStep;           // starting from 0 to 2pi
-
-            // vertex position (x, y, z)
-            x = xy * cosf(sectorAngle);             // r * cos(u) * cos(v)
-            y = xy * sinf(sectorAngle);             // r * cos(u) * sin(v)
-            vertices.push_back(x);
-            vertices.push_back(y);
-            vertices.push_back(z);
-        }
-    }
-    // indices
-    //  k1--k1+1
-    //  |  / |
-    //  | /  |
-    //  k2--k2+1
-    unsigned int k1, k2;
-    for (int i = 0; i < stackCount; ++i)
-    {
-        k1 = i * (sectorCount + 1);     // beginning of current stack
-        k2 = k1 + sectorCount + 1;      // beginning of next stack
-
-        for (int j = 0; j < sectorCount; ++j, ++k1, ++k2)
-        {
-            // 2 triangles per sector excluding 1st and last stacks
-            if (i != 0)
-            {
-                indices.push_back(k1);
-                indices.push_back(k2);
-                indices.push_back(k1 + 1);
-            }
-
-            if (i != (stackCount - 1))
-            {
-                indices.push_back(k1 + 1);
-                indices.push_back(k2);
-                indices.push_back(k2 + 1);
-            }
-
-            // vertical lines for all stacks
-            lineIndices.push_back(k1);
-            lineIndices.push_back(k2);
-            if (i != 0)  // horizontal lines except 1st stack
-            {
-                lineIndices.push_back(k1);
-                lineIndices.push_back(k1 + 1);
-            }
-        }
-    }
-}
 
 void processInput(GLFWwindow* window)
 {
+    // Без окна (CLOTH_HEADLESS) ввода нет
+    if (!window)
+        return;
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
 }
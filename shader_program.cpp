@@ -0,0 +1,247 @@
+#include "shader_program.h"
+#include "program_cache.h"
+#include <cstring>
+#include <iostream>
+
+// Program that use() made current. glUseProgram is global state of the
+// context, so this is shared by all ShaderProgram objects.
+static GLuint current_program = 0;
+
+static GLuint compile(GLenum type, const char* source, const char* name) {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+    int success;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        char infoLog[512];
+        glGetShaderInfoLog(shader, 512, NULL, infoLog);
+        std::cout << "ERROR::SHADER::" << name << "::COMPILATION_FAILED\n" << infoLog << std::endl;
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+ShaderProgram::ShaderProgram() {
+    program = 0;
+    owned = false;
+    loaded = false;
+    skipped_uploads = 0;
+}
+
+ShaderProgram::~ShaderProgram() {
+    release();
+}
+
+bool ShaderProgram::build(const char* vertex_source, const char* fragment_source) {
+    return build(vertex_source, NULL, fragment_source);
+}
+
+bool ShaderProgram::build(const char* vertex_source, const char* geometry_source, const char* fragment_source,
+    const char* cache_dir) {
+    release();
+    const bool use_cache = cache_dir && program_binary_supported();
+    uint64_t key = 0;
+    std::string path;
+    if (use_cache) {
+        const char* sources[3] = { vertex_source, geometry_source, fragment_source };
+        key = program_cache_key(sources, 3);
+        path = program_cache_path(cache_dir, key);
+        GLuint p = load_program_binary(path, key);
+        if (p) {
+            attach(p);
+            owned = true;
+            loaded = true;
+            return true;
+        }
+    }
+
+    GLuint vs = compile(GL_VERTEX_SHADER, vertex_source, "VERTEX");
+    GLuint gs = geometry_source ? compile(GL_GEOMETRY_SHADER, geometry_source, "GEOMETRY") : 0;
+    GLuint fs = compile(GL_FRAGMENT_SHADER, fragment_source, "FRAGMENT");
+    if (!vs || !fs || (geometry_source && !gs)) {
+        glDeleteShader(vs);
+        glDeleteShader(gs);
+        glDeleteShader(fs);
+        return false;
+    }
+
+    GLuint p = glCreateProgram();
+    glAttachShader(p, vs);
+    if (gs)
+        glAttachShader(p, gs);
+    glAttachShader(p, fs);
+#ifdef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+    if (use_cache)
+        glProgramParameteri(p, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+#endif
+    glLinkProgram(p);
+    glDeleteShader(vs);
+    glDeleteShader(gs);
+    glDeleteShader(fs);
+    int success;
+    glGetProgramiv(p, GL_LINK_STATUS, &success);
+    if (!success) {
+        char infoLog[512];
+        glGetProgramInfoLog(p, 512, NULL, infoLog);
+        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+        glDeleteProgram(p);
+        return false;
+    }
+    if (use_cache)
+        save_program_binary(path, key, p);
+    attach(p);
+    owned = true;
+    return true;
+}
+
+void ShaderProgram::attach(GLuint program) {
+    release();
+    this->program = program;
+    owned = false;
+    reflect();
+}
+
+void ShaderProgram::release() {
+    if (program && owned) {
+        if (current_program == program)
+            current_program = 0;
+        glDeleteProgram(program);
+    }
+    program = 0;
+    owned = false;
+    loaded = false;
+    uniforms.clear();
+    uniform_index.clear();
+    attributes.clear();
+    warned.clear();
+    skipped_uploads = 0;
+}
+
+void ShaderProgram::reflect() {
+    GLint count = 0, longest = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &longest);
+    std::vector<char> name(longest > 0 ? longest : 1);
+    for (GLint i = 0; i < count; ++i) {
+        Uniform u;
+        GLsizei length = 0;
+        glGetActiveUniform(program, (GLuint)i, (GLsizei)name.size(), &length, &u.size, &u.type, name.data());
+        u.name.assign(name.data(), length);
+        u.location = glGetUniformLocation(program, u.name.c_str());
+        // members of uniform blocks have no location and no glUniform*
+        if (u.location < 0)
+            continue;
+        u.known = false;
+        memset(u.value, 0, sizeof(u.value));
+
+        const int index = (int)uniforms.size();
+        uniform_index[u.name] = index;
+        // arrays are reported as "name[0]"; "name" means the same element
+        size_t bracket = u.name.find('[');
+        if (bracket != std::string::npos)
+            uniform_index[u.name.substr(0, bracket)] = index;
+        uniforms.push_back(u);
+    }
+
+    count = 0;
+    longest = 0;
+    glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &count);
+    glGetProgramiv(program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &longest);
+    name.assign(longest > 0 ? longest : 1, 0);
+    for (GLint i = 0; i < count; ++i) {
+        GLsizei length = 0;
+        GLint size;
+        GLenum type;
+        glGetActiveAttrib(program, (GLuint)i, (GLsizei)name.size(), &length, &size, &type, name.data());
+        std::string attribute(name.data(), length);
+        attributes[attribute] = glGetAttribLocation(program, attribute.c_str());
+    }
+}
+
+void ShaderProgram::warn(const char* what, const char* name) const {
+    if (warned.insert(name).second)
+        std::cout << "WARNING::SHADER::PROGRAM " << program << " has no active " << what << " \"" << name << "\"" << std::endl;
+}
+
+int ShaderProgram::uniform(const char* name) const {
+    std::unordered_map<std::string, int>::const_iterator it = uniform_index.find(name);
+    if (it == uniform_index.end()) {
+        warn("uniform", name);
+        return -1;
+    }
+    return it->second;
+}
+
+GLint ShaderProgram::attribute(const char* name) const {
+    std::unordered_map<std::string, GLint>::const_iterator it = attributes.find(name);
+    if (it == attributes.end()) {
+        warn("attribute", name);
+        return -1;
+    }
+    return it->second;
+}
+
+void ShaderProgram::use() {
+    if (current_program != program) {
+        glUseProgram(program);
+        current_program = program;
+    }
+}
+
+void ShaderProgram::forget_current() {
+    current_program = 0;
+}
+
+// Compares and stores the raw bits, so ints and floats share the cache.
+bool ShaderProgram::changed(int u, const float* v, int n) {
+    Uniform& un = uniforms[u];
+    if (un.known && memcmp(un.value, v, n * sizeof(float)) == 0) {
+        ++skipped_uploads;
+        return false;
+    }
+    memcpy(un.value, v, n * sizeof(float));
+    un.known = true;
+    return true;
+}
+
+void ShaderProgram::set(int u, int v) {
+    float bits;
+    memcpy(&bits, &v, sizeof(bits));
+    if (u >= 0 && changed(u, &bits, 1))
+        glUniform1i(uniforms[u].location, v);
+}
+
+void ShaderProgram::set(int u, float v) {
+    if (u >= 0 && changed(u, &v, 1))
+        glUniform1f(uniforms[u].location, v);
+}
+
+void ShaderProgram::set(int u, float x, float y) {
+    float v[2] = { x, y };
+    if (u >= 0 && changed(u, v, 2))
+        glUniform2f(uniforms[u].location, x, y);
+}
+
+void ShaderProgram::set(int u, float x, float y, float z) {
+    float v[3] = { x, y, z };
+    if (u >= 0 && changed(u, v, 3))
+        glUniform3f(uniforms[u].location, x, y, z);
+}
+
+void ShaderProgram::set(int u, float x, float y, float z, float w) {
+    float v[4] = { x, y, z, w };
+    if (u >= 0 && changed(u, v, 4))
+        glUniform4f(uniforms[u].location, x, y, z, w);
+}
+
+void ShaderProgram::set_vec3(int u, const float* v) {
+    if (u >= 0 && changed(u, v, 3))
+        glUniform3fv(uniforms[u].location, 1, v);
+}
+
+void ShaderProgram::set_mat4(int u, const float* m) {
+    if (u >= 0 && changed(u, m, 16))
+        glUniformMatrix4fv(uniforms[u].location, 1, GL_FALSE, m);
+}
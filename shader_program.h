@@ -0,0 +1,94 @@
+#ifndef SHADER_PROGRAM_H
+#define SHADER_PROGRAM_H
+
+#include <glad/glad.h>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Linked GL program with every active uniform and attribute read back once
+// at link time into hash tables, so the frame loop never asks the driver to
+// look a name up. Uniforms are addressed by the index uniform() returns:
+//
+//     int model = program.uniform("model");   // once, after linking
+//     ...
+//     program.use();
+//     program.set_mat4(model, &m[0][0]);      // every frame
+//
+// Uniform values belong to the program, so the setters remember the last
+// value of every uniform and skip the glUniform* call when it is the same.
+// The setters write to the current program: call use() first. use() skips
+// glUseProgram when the program is already current, as far as use() knows;
+// after calling glUseProgram directly, call forget_current().
+class ShaderProgram {
+public:
+    ShaderProgram();
+    ~ShaderProgram();
+
+    ShaderProgram(const ShaderProgram&) = delete;
+    ShaderProgram& operator=(const ShaderProgram&) = delete;
+
+    // Compiles, links and reflects; prints the info log and returns false on
+    // failure. The program is deleted with this object.
+    bool build(const char* vertex_source, const char* fragment_source);
+    // Same with a geometry shader between the two (GL 3.2), which may be
+    // NULL. With a cache_dir the linked program is saved there as a driver
+    // binary and later builds of the same sources load it instead of
+    // compiling; see program_cache.h.
+    bool build(const char* vertex_source, const char* geometry_source, const char* fragment_source,
+        const char* cache_dir = NULL);
+    // Reflects a program the caller linked and keeps owning.
+    void attach(GLuint program);
+    void release();
+
+    GLuint id() const { return program; }
+    // True if build() loaded the program from the cache.
+    bool from_cache() const { return loaded; }
+    void use();
+    static void forget_current();
+
+    // Index of an active uniform for the setters, or -1 with a warning the
+    // first time a name is not in the program (misspelt, or optimized out).
+    // The setters ignore -1, like glUniform* ignores location -1.
+    int uniform(const char* name) const;
+    // Location of an active attribute, or -1 with a warning.
+    GLint attribute(const char* name) const;
+    int uniform_count() const { return (int)uniforms.size(); }
+
+    void set(int u, int v);
+    void set(int u, float v);
+    void set(int u, float x, float y);
+    void set(int u, float x, float y, float z);
+    void set(int u, float x, float y, float z, float w);
+    void set_vec3(int u, const float* v);
+    void set_mat4(int u, const float* m);
+
+    // Redundant uploads skipped so far, for profiling.
+    long long skipped() const { return skipped_uploads; }
+
+private:
+    struct Uniform {
+        std::string name;
+        GLint location;
+        GLenum type;
+        GLint size;
+        bool known;             // value holds what the program has
+        float value[16];
+    };
+
+    void reflect();
+    bool changed(int u, const float* v, int n);
+    void warn(const char* what, const char* name) const;
+
+    GLuint program;
+    bool owned;
+    bool loaded;
+    std::vector<Uniform> uniforms;
+    std::unordered_map<std::string, int> uniform_index;
+    std::unordered_map<std::string, GLint> attributes;
+    mutable std::unordered_set<std::string> warned;
+    long long skipped_uploads;
+};
+
+#endif
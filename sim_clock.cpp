@@ -0,0 +1,65 @@
+#include "sim_clock.h"
+
+SimClock::SimClock(double dt, int substeps, int max_steps) {
+    this->dt = 1.0 / 60.0;
+    this->substeps = 1;
+    this->max_steps = 5;
+    set_dt(dt);
+    set_substeps(substeps);
+    set_max_steps(max_steps);
+    reset();
+}
+
+void SimClock::set_dt(double dt) {
+    if (dt > 0.0)
+        this->dt = dt;
+}
+
+void SimClock::set_substeps(int substeps) {
+    this->substeps = substeps > 0 ? substeps : 1;
+}
+
+void SimClock::set_max_steps(int max_steps) {
+    this->max_steps = max_steps > 0 ? max_steps : 1;
+}
+
+void SimClock::reset() {
+    accumulator = 0.0;
+    last = 0.0;
+    started = false;
+    steps = 0;
+    lost = 0.0;
+}
+
+int SimClock::tick(double now) {
+    if (!started) {
+        started = true;
+        last = now;
+        return 0;
+    }
+    double elapsed = now - last;
+    last = now;
+    return advance(elapsed);
+}
+
+int SimClock::advance(double elapsed) {
+    // a clock that went backwards or a paused debugger gives nothing odd
+    if (elapsed > 0.0)
+        accumulator += elapsed;
+
+    int count = (int)(accumulator / dt);
+    if (count > max_steps) {
+        lost += (count - max_steps) * dt;
+        count = max_steps;
+    }
+    accumulator -= (int)(accumulator / dt) * dt;
+    if (accumulator < 0.0)
+        accumulator = 0.0;
+    steps += count;
+    return count;
+}
+
+void interpolate(const float* a, const float* b, float t, float* out, int count) {
+    for (int k = 0; k < count; ++k)
+        out[k] = a[k] + (b[k] - a[k]) * t;
+}
@@ -0,0 +1,59 @@
+#ifndef SIM_CLOCK_H
+#define SIM_CLOCK_H
+
+// Fixed-step simulation clock. The render loop feeds it real time, which
+// piles up in an accumulator and comes out as whole steps of dt, so the
+// simulation runs at the same speed on a 60 Hz and on a 240 Hz display:
+//
+//     int steps = clock.tick(glfwGetTime());
+//     for (int s = 0; s < steps; ++s)
+//         for (int k = 0; k < clock.get_substeps(); ++k)
+//             simulate(clock.substep_dt());
+//     draw(lerp(previous state, current state, clock.alpha()));
+//
+// A frame that took too long would ask for more steps than can be run
+// before the next frame, which makes that frame slow too. tick() never
+// returns more than max_steps and drops the rest of the time instead: the
+// simulation then runs slower than real time but does not stall.
+class SimClock {
+public:
+    explicit SimClock(double dt = 1.0 / 60.0, int substeps = 1, int max_steps = 5);
+
+    void set_dt(double dt);
+    double get_dt() const { return dt; }
+    void set_substeps(int substeps);
+    int get_substeps() const { return substeps; }
+    double substep_dt() const { return dt / substeps; }
+    void set_max_steps(int max_steps);
+    int get_max_steps() const { return max_steps; }
+
+    // Takes the current time in seconds, e.g. glfwGetTime(), and returns the
+    // number of steps to run now. The first call only starts the clock.
+    int tick(double now);
+    // Same with the seconds passed since the last call.
+    int advance(double elapsed);
+
+    // Leftover time as a fraction of a step, in [0, 1): how far real time
+    // is past the last step, for interpolating the drawn state.
+    double alpha() const { return accumulator / dt; }
+    double time() const { return steps * dt; }      // simulated seconds
+    long long step_count() const { return steps; }
+    double dropped() const { return lost; }         // real seconds given up by the cap
+
+    void reset();
+
+private:
+    double dt;
+    int substeps;
+    int max_steps;
+    double accumulator;
+    double last;
+    bool started;
+    long long steps;
+    double lost;
+};
+
+// out[k] = a[k] + (b[k] - a[k]) * t for count floats; out may be a or b.
+void interpolate(const float* a, const float* b, float t, float* out, int count);
+
+#endif
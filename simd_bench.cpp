@@ -0,0 +1,148 @@
+// Microbenchmark of the SIMD cloth kernels: runs every kernel for every
+// instruction set the CPU supports, checks the result against the scalar
+// kernel and prints the time per particle and the speedup.
+//
+//     simd_bench [grid size, default 1024]
+
+#include "cloth_solver.h"
+#include "simd_kernels.h"
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+static int64_t ordered(float f) {
+    int32_t i;
+    memcpy(&i, &f, sizeof(i));
+    return i < 0 ? (int64_t)INT32_MIN - i : i;
+}
+
+// Largest distance in ulp between two arrays.
+static int64_t max_ulp(const std::vector<float>& a, const std::vector<float>& b) {
+    int64_t worst = 0;
+    for (size_t i = 0; i < a.size(); ++i) {
+        int64_t d = ordered(a[i]) - ordered(b[i]);
+        if (d < 0)
+            d = -d;
+        if (d > worst)
+            worst = d;
+    }
+    return worst;
+}
+
+static int64_t max_ulp(const ClothParticles& a, const ClothParticles& b) {
+    int64_t worst = 0;
+    const std::vector<float>* fa[] = { &a.x, &a.y, &a.z, &a.vx, &a.vy, &a.vz };
+    const std::vector<float>* fb[] = { &b.x, &b.y, &b.z, &b.vx, &b.vy, &b.vz };
+    for (int f = 0; f < 6; ++f) {
+        int64_t d = max_ulp(*fa[f], *fb[f]);
+        if (d > worst)
+            worst = d;
+    }
+    return worst;
+}
+
+static ClothParticles make_particles(int size) {
+    ClothSolver cloth(size, size, 1.0f / size);
+    ClothParticles p = cloth.particles();
+    srand(1);
+    for (int i = 0; i < p.size(); ++i) {
+        p.x[i] += (rand() % 1000) * 1e-6f;
+        p.z[i] = (rand() % 1000) * 1e-4f;
+        p.vx[i] = (rand() % 1000 - 500) * 1e-3f;
+        p.vy[i] = (rand() % 1000 - 500) * 1e-3f;
+        p.inv_mass[i] = i % 97 == 0 ? 0.0f : 1.0f;
+    }
+    return p;
+}
+
+// Vertical links between even rows and the row below: no particle is shared,
+// as the vector projection requires.
+static DistanceConstraints make_links(const ClothParticles& p) {
+    DistanceConstraints c;
+    for (int i = 0; i + 1 < p.rows; i += 2)
+        for (int j = 0; j < p.cols; ++j)
+            c.add(p.index(i, j), p.index(i + 1, j), 0.9f / p.rows);
+    return c;
+}
+
+struct Result {
+    double ns;
+    int64_t ulp;
+};
+
+template <class F>
+static double time_ns(F f, int reps, int items) {
+    auto t0 = std::chrono::steady_clock::now();
+    for (int r = 0; r < reps; ++r)
+        f();
+    double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    return s * 1e9 / ((double)reps * items);
+}
+
+int main(int argc, char* argv[]) {
+    int size = argc > 1 ? atoi(argv[1]) : 1024;
+    const int reps = 20;
+    const float accel[3] = { 0.5f, -9.81f, 0.25f };
+    const float dt = 1.0f / 60.0f;
+
+    const ClothParticles start = make_particles(size);
+    const DistanceConstraints links = make_links(start);
+    const int n = start.size();
+
+    const ClothKernels* scalar = cloth_kernels_for(ISA_SCALAR);
+    Result base[3];
+    ClothParticles ref[3];
+
+    printf("%d particles, %d links, %d repetitions\n", n, links.size(), reps);
+    printf("%-8s %-16s %12s %9s %8s\n", "isa", "kernel", "ns/particle", "speedup", "max ulp");
+
+    for (int isa = 0; isa < ISA_COUNT; ++isa) {
+        const ClothKernels* k = cloth_kernels_for((SimdIsa)isa);
+        if (!k)
+            continue;
+
+        Result r[3];
+        ClothParticles out[3];
+
+        // integrate
+        ClothParticles p = start;
+        r[0].ns = time_ns([&] { k->integrate(p, 0, n, accel, 0.99f, dt); }, reps, n);
+        out[0] = start;
+        k->integrate(out[0], 0, n, accel, 0.99f, dt);
+
+        // update_velocity
+        p = start;
+        std::vector<float> px(n, 0.1f), py(n, 0.2f), pz(n, 0.3f);
+        r[1].ns = time_ns([&] { k->update_velocity(p, px.data(), py.data(), pz.data(), 0, n, 60.0f); }, reps, n);
+        out[1] = start;
+        k->update_velocity(out[1], px.data(), py.data(), pz.data(), 0, n, 60.0f);
+
+        // project_distance, one sweep per repetition
+        p = start;
+        DistanceConstraints c = links;
+        r[2].ns = time_ns([&] { k->project_distance(p, c, 0, c.size(), 1e-4f); }, reps, c.size());
+        out[2] = start;
+        c = links;
+        k->project_distance(out[2], c, 0, c.size(), 1e-4f);
+
+        if (k == scalar) {
+            for (int i = 0; i < 3; ++i) {
+                base[i] = r[i];
+                ref[i] = out[i];
+            }
+        }
+
+        static const char* names[3] = { "integrate", "update_velocity", "project_distance" };
+        for (int i = 0; i < 3; ++i) {
+            r[i].ulp = max_ulp(out[i], ref[i]);
+            printf("%-8s %-16s %12.3f %8.2fx %8lld%s\n", k->name, names[i], r[i].ns,
+                base[i].ns / r[i].ns, (long long)r[i].ulp, r[i].ulp > 2 ? "  OUT OF TOLERANCE" : "");
+        }
+    }
+    printf("selected: %s\n", cloth_kernels().name);
+    return 0;
+}
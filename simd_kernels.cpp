@@ -0,0 +1,182 @@
+#include "simd_kernels.h"
+#include "cloth_solver.h"
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SIMD_X86 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+extern const ClothKernels sse42_kernels;
+extern const ClothKernels avx2_kernels;
+extern const ClothKernels avx512_kernels;
+#endif
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define SIMD_NEON 1
+extern const ClothKernels neon_kernels;
+#endif
+
+// Scalar reference kernels. The vector kernels must give the same results
+// within the tolerance documented in simd_kernels.h.
+
+static void integrate_scalar(ClothParticles& p, int begin, int end,
+    const float accel[3], float keep, float dt) {
+    const float gx = accel[0] * dt, gy = accel[1] * dt, gz = accel[2] * dt;
+    float* x = p.x.data();
+    float* y = p.y.data();
+    float* z = p.z.data();
+    float* vx = p.vx.data();
+    float* vy = p.vy.data();
+    float* vz = p.vz.data();
+    const float* w = p.inv_mass.data();
+
+    for (int i = begin; i < end; ++i) {
+        float active = w[i] > 0.0f ? 1.0f : 0.0f;
+        vx[i] = (vx[i] + gx * active) * keep;
+        vy[i] = (vy[i] + gy * active) * keep;
+        vz[i] = (vz[i] + gz * active) * keep;
+        x[i] += vx[i] * dt * active;
+        y[i] += vy[i] * dt * active;
+        z[i] += vz[i] * dt * active;
+    }
+}
+
+static void update_velocity_scalar(ClothParticles& p, const float* prev_x, const float* prev_y,
+    const float* prev_z, int begin, int end, float inv_h) {
+    for (int i = begin; i < end; ++i) {
+        p.vx[i] = (p.x[i] - prev_x[i]) * inv_h;
+        p.vy[i] = (p.y[i] - prev_y[i]) * inv_h;
+        p.vz[i] = (p.z[i] - prev_z[i]) * inv_h;
+    }
+}
+
+static void project_distance_scalar(ClothParticles& p, DistanceConstraints& c,
+    int begin, int end, float alpha) {
+    float* x = p.x.data();
+    float* y = p.y.data();
+    float* z = p.z.data();
+    const float* w = p.inv_mass.data();
+
+    for (int k = begin; k < end; ++k) {
+        int i = c.a[k], j = c.b[k];
+        float wsum = w[i] + w[j];
+        if (wsum == 0.0f)
+            continue;
+
+        float dx = x[i] - x[j];
+        float dy = y[i] - y[j];
+        float dz = z[i] - z[j];
+        float len2 = dx * dx + dy * dy + dz * dz;
+        if (len2 < 1e-18f)
+            continue;
+        float inv_len = 1.0f / sqrtf(len2);
+
+        float C = len2 * inv_len - c.rest[k];
+        float dlambda = (-C - alpha * c.lambda[k]) / (wsum + alpha);
+        c.lambda[k] += dlambda;
+
+        float s = dlambda * inv_len;
+        x[i] += w[i] * s * dx; y[i] += w[i] * s * dy; z[i] += w[i] * s * dz;
+        x[j] -= w[j] * s * dx; y[j] -= w[j] * s * dy; z[j] -= w[j] * s * dz;
+    }
+}
+
+static const ClothKernels scalar_kernels = {
+    ISA_SCALAR, "scalar",
+    integrate_scalar,
+    update_velocity_scalar,
+    project_distance_scalar
+};
+
+static bool cpu_has(SimdIsa isa) {
+    switch (isa) {
+    case ISA_SCALAR:
+        return true;
+#if SIMD_X86
+#if defined(_MSC_VER)
+    case ISA_SSE42:
+    case ISA_AVX2:
+    case ISA_AVX512: {
+        int info[4];
+        __cpuid(info, 1);
+        bool sse42 = (info[2] & (1 << 20)) != 0;
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        if (isa == ISA_SSE42)
+            return sse42;
+        if (!osxsave)
+            return false;
+        unsigned long long xcr0 = _xgetbv(0);
+        __cpuidex(info, 7, 0);
+        if (isa == ISA_AVX2)
+            return (xcr0 & 0x6) == 0x6 && (info[1] & (1 << 5)) != 0;
+        return (xcr0 & 0xe6) == 0xe6 && (info[1] & (1 << 16)) != 0;
+    }
+#else
+    case ISA_SSE42:
+        return __builtin_cpu_supports("sse4.2");
+    case ISA_AVX2:
+        return __builtin_cpu_supports("avx2");
+    case ISA_AVX512:
+        return __builtin_cpu_supports("avx512f");
+#endif
+#endif
+#if SIMD_NEON
+    case ISA_NEON:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+const ClothKernels* cloth_kernels_for(SimdIsa isa) {
+    if (!cpu_has(isa))
+        return NULL;
+    switch (isa) {
+    case ISA_SCALAR: return &scalar_kernels;
+#if SIMD_X86
+    case ISA_SSE42: return &sse42_kernels;
+    case ISA_AVX2: return &avx2_kernels;
+    case ISA_AVX512: return &avx512_kernels;
+#endif
+#if SIMD_NEON
+    case ISA_NEON: return &neon_kernels;
+#endif
+    default: return NULL;
+    }
+}
+
+static const ClothKernels* pick_kernels() {
+    static const char* names[ISA_COUNT] = { "scalar", "sse4.2", "avx2", "avx512", "neon" };
+    static const SimdIsa order[] = { ISA_AVX512, ISA_AVX2, ISA_SSE42, ISA_NEON };
+
+    // CLOTH_SIMD caps the instruction set, e.g. CLOTH_SIMD=avx2 skips avx512
+    SimdIsa cap = ISA_AVX512;
+    bool capped = false;
+    const char* env = getenv("CLOTH_SIMD");
+    if (env) {
+        for (int i = 0; i < ISA_COUNT; ++i) {
+            if (strcmp(env, names[i]) == 0) {
+                cap = (SimdIsa)i;
+                capped = true;
+            }
+        }
+    }
+
+    for (SimdIsa isa : order) {
+        if (capped && isa > cap)
+            continue;
+        const ClothKernels* k = cloth_kernels_for(isa);
+        if (k)
+            return k;
+    }
+    return &scalar_kernels;
+}
+
+const ClothKernels& cloth_kernels() {
+    static const ClothKernels* kernels = pick_kernels();
+    return *kernels;
+}
@@ -0,0 +1,52 @@
+#ifndef SIMD_KERNELS_H
+#define SIMD_KERNELS_H
+
+struct ClothParticles;
+struct DistanceConstraints;
+
+enum SimdIsa {
+    ISA_SCALAR,
+    ISA_SSE42,      // 4 particles per instruction
+    ISA_AVX2,       // 8 particles per instruction
+    ISA_AVX512,     // 16 particles per instruction
+    ISA_NEON,       // 4 particles per instruction
+    ISA_COUNT
+};
+
+// Per-particle loops of the solvers. Every kernel works on the half-open
+// range [begin, end) so callers can split the work between threads.
+//
+// Tolerance against the scalar kernels: every output component is within
+// 2 ulp of the scalar result per call. The vector code performs the same
+// operations in the same order and uses exact sqrt and division, so on x86
+// integrate and update_velocity are bit for bit equal; the remaining slack
+// covers compilers that contract multiply-adds into FMA (GCC on AArch64).
+struct ClothKernels {
+    SimdIsa isa;
+    const char* name;
+
+    // v = (v + accel * dt) * keep, x += v * dt; pinned particles
+    // (inv_mass == 0) neither accelerate nor move.
+    void (*integrate)(ClothParticles& p, int begin, int end,
+        const float accel[3], float keep, float dt);
+
+    // v = (x - prev) * inv_h
+    void (*update_velocity)(ClothParticles& p, const float* prev_x, const float* prev_y,
+        const float* prev_z, int begin, int end, float inv_h);
+
+    // One XPBD pass over constraints [begin, end) of c. The vector versions
+    // project several constraints at once, so no two constraints of the
+    // range may share a particle. alpha is the compliance divided by h^2.
+    void (*project_distance)(ClothParticles& p, DistanceConstraints& c,
+        int begin, int end, float alpha);
+};
+
+// Best kernels for this CPU, picked once at first call. Setting the
+// CLOTH_SIMD environment variable to scalar, sse4.2, avx2, avx512 or neon
+// caps the choice, which is handy for comparisons.
+const ClothKernels& cloth_kernels();
+
+// Kernels for one instruction set or NULL if this build or CPU lacks it.
+const ClothKernels* cloth_kernels_for(SimdIsa isa);
+
+#endif
@@ -0,0 +1,126 @@
+#include "simd_kernels.h"
+#include "cloth_solver.h"
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+
+#include <arm_neon.h>
+
+// NEON is part of every AArch64 CPU, so these kernels need no runtime check.
+// 32-bit ARM lacks vector sqrt and division and keeps the scalar kernels.
+
+static const ClothKernels& scalar() {
+    return *cloth_kernels_for(ISA_SCALAR);
+}
+
+static void integrate_neon(ClothParticles& p, int begin, int end,
+    const float accel[3], float keep, float dt) {
+    float* x = p.x.data();
+    float* y = p.y.data();
+    float* z = p.z.data();
+    float* vx = p.vx.data();
+    float* vy = p.vy.data();
+    float* vz = p.vz.data();
+    const float* w = p.inv_mass.data();
+    const float32x4_t gx = vdupq_n_f32(accel[0] * dt);
+    const float32x4_t gy = vdupq_n_f32(accel[1] * dt);
+    const float32x4_t gz = vdupq_n_f32(accel[2] * dt);
+    const float32x4_t vkeep = vdupq_n_f32(keep);
+    const float32x4_t vdt = vdupq_n_f32(dt);
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    const float32x4_t one = vdupq_n_f32(1.0f);
+
+    int i = begin;
+    for (; i + 4 <= end; i += 4) {
+        float32x4_t active = vbslq_f32(vcgtq_f32(vld1q_f32(w + i), zero), one, zero);
+        float32x4_t u = vmulq_f32(vaddq_f32(vld1q_f32(vx + i), vmulq_f32(gx, active)), vkeep);
+        float32x4_t v = vmulq_f32(vaddq_f32(vld1q_f32(vy + i), vmulq_f32(gy, active)), vkeep);
+        float32x4_t t = vmulq_f32(vaddq_f32(vld1q_f32(vz + i), vmulq_f32(gz, active)), vkeep);
+        vst1q_f32(vx + i, u);
+        vst1q_f32(vy + i, v);
+        vst1q_f32(vz + i, t);
+        vst1q_f32(x + i, vaddq_f32(vld1q_f32(x + i), vmulq_f32(vmulq_f32(u, vdt), active)));
+        vst1q_f32(y + i, vaddq_f32(vld1q_f32(y + i), vmulq_f32(vmulq_f32(v, vdt), active)));
+        vst1q_f32(z + i, vaddq_f32(vld1q_f32(z + i), vmulq_f32(vmulq_f32(t, vdt), active)));
+    }
+    scalar().integrate(p, i, end, accel, keep, dt);
+}
+
+static void update_velocity_neon(ClothParticles& p, const float* prev_x, const float* prev_y,
+    const float* prev_z, int begin, int end, float inv_h) {
+    const float32x4_t k = vdupq_n_f32(inv_h);
+    int i = begin;
+    for (; i + 4 <= end; i += 4) {
+        vst1q_f32(&p.vx[i], vmulq_f32(vsubq_f32(vld1q_f32(&p.x[i]), vld1q_f32(prev_x + i)), k));
+        vst1q_f32(&p.vy[i], vmulq_f32(vsubq_f32(vld1q_f32(&p.y[i]), vld1q_f32(prev_y + i)), k));
+        vst1q_f32(&p.vz[i], vmulq_f32(vsubq_f32(vld1q_f32(&p.z[i]), vld1q_f32(prev_z + i)), k));
+    }
+    scalar().update_velocity(p, prev_x, prev_y, prev_z, i, end, inv_h);
+}
+
+static float32x4_t gather(const float* base, const int* index) {
+    float lanes[4] = { base[index[0]], base[index[1]], base[index[2]], base[index[3]] };
+    return vld1q_f32(lanes);
+}
+
+static void project_distance_neon(ClothParticles& p, DistanceConstraints& c,
+    int begin, int end, float alpha) {
+    float* x = p.x.data();
+    float* y = p.y.data();
+    float* z = p.z.data();
+    const float* w = p.inv_mass.data();
+    const int* a = c.a.data();
+    const int* b = c.b.data();
+    const float32x4_t valpha = vdupq_n_f32(alpha);
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    const float32x4_t eps = vdupq_n_f32(1e-18f);
+    float out[6][4];
+
+    int k = begin;
+    for (; k + 4 <= end; k += 4) {
+        const int* i = a + k;
+        const int* j = b + k;
+        float32x4_t wi = gather(w, i), wj = gather(w, j);
+        float32x4_t xi = gather(x, i), yi = gather(y, i), zi = gather(z, i);
+        float32x4_t xj = gather(x, j), yj = gather(y, j), zj = gather(z, j);
+
+        float32x4_t wsum = vaddq_f32(wi, wj);
+        float32x4_t dx = vsubq_f32(xi, xj);
+        float32x4_t dy = vsubq_f32(yi, yj);
+        float32x4_t dz = vsubq_f32(zi, zj);
+        float32x4_t len2 = vaddq_f32(vaddq_f32(vmulq_f32(dx, dx), vmulq_f32(dy, dy)), vmulq_f32(dz, dz));
+        uint32x4_t valid = vandq_u32(vmvnq_u32(vceqq_f32(wsum, zero)), vcgeq_f32(len2, eps));
+        float32x4_t inv_len = vdivq_f32(one, vsqrtq_f32(len2));
+
+        float32x4_t C = vsubq_f32(vmulq_f32(len2, inv_len), vld1q_f32(&c.rest[k]));
+        float32x4_t lambda = vld1q_f32(&c.lambda[k]);
+        float32x4_t dl = vdivq_f32(vsubq_f32(vnegq_f32(C), vmulq_f32(valpha, lambda)),
+            vaddq_f32(wsum, valpha));
+        dl = vbslq_f32(valid, dl, zero);
+        vst1q_f32(&c.lambda[k], vaddq_f32(lambda, dl));
+
+        float32x4_t s = vbslq_f32(valid, vmulq_f32(dl, inv_len), zero);
+        float32x4_t si = vmulq_f32(wi, s);
+        float32x4_t sj = vmulq_f32(wj, s);
+        vst1q_f32(out[0], vaddq_f32(xi, vmulq_f32(si, dx)));
+        vst1q_f32(out[1], vaddq_f32(yi, vmulq_f32(si, dy)));
+        vst1q_f32(out[2], vaddq_f32(zi, vmulq_f32(si, dz)));
+        vst1q_f32(out[3], vsubq_f32(xj, vmulq_f32(sj, dx)));
+        vst1q_f32(out[4], vsubq_f32(yj, vmulq_f32(sj, dy)));
+        vst1q_f32(out[5], vsubq_f32(zj, vmulq_f32(sj, dz)));
+        for (int l = 0; l < 4; ++l) {
+            x[i[l]] = out[0][l]; y[i[l]] = out[1][l]; z[i[l]] = out[2][l];
+            x[j[l]] = out[3][l]; y[j[l]] = out[4][l]; z[j[l]] = out[5][l];
+        }
+    }
+    scalar().project_distance(p, c, k, end, alpha);
+}
+
+extern const ClothKernels neon_kernels = {
+    ISA_NEON, "neon",
+    integrate_neon,
+    update_velocity_neon,
+    project_distance_neon
+};
+
+#endif
@@ -0,0 +1,381 @@
+#include "simd_kernels.h"
+#include "cloth_solver.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+
+#include <immintrin.h>
+
+// Every function is compiled for its own instruction set, so this file needs
+// no special compiler flags; cloth_kernels() only hands a table out after
+// checking the CPU supports it.
+#if defined(_MSC_VER) && !defined(__clang__)
+#define SIMD_TARGET(isa)
+#else
+#define SIMD_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+// AVX-512 brings FMA with it; fusing a multiply and an add rounds once
+// instead of twice and the results would drift from the scalar kernels.
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+// the gather and sqrt intrinsics start from _mm512_undefined_ps()
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+// Leftover elements that do not fill a whole register go to the scalar kernel.
+static const ClothKernels& scalar() {
+    return *cloth_kernels_for(ISA_SCALAR);
+}
+
+// SSE4.2: 4 particles per instruction
+
+SIMD_TARGET("sse4.2")
+static void integrate_sse42(ClothParticles& p, int begin, int end,
+    const float accel[3], float keep, float dt) {
+    float* x = p.x.data();
+    float* y = p.y.data();
+    float* z = p.z.data();
+    float* vx = p.vx.data();
+    float* vy = p.vy.data();
+    float* vz = p.vz.data();
+    const float* w = p.inv_mass.data();
+    const __m128 gx = _mm_set1_ps(accel[0] * dt);
+    const __m128 gy = _mm_set1_ps(accel[1] * dt);
+    const __m128 gz = _mm_set1_ps(accel[2] * dt);
+    const __m128 vkeep = _mm_set1_ps(keep);
+    const __m128 vdt = _mm_set1_ps(dt);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+
+    int i = begin;
+    for (; i + 4 <= end; i += 4) {
+        __m128 active = _mm_and_ps(_mm_cmpgt_ps(_mm_loadu_ps(w + i), zero), one);
+        __m128 u = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(vx + i), _mm_mul_ps(gx, active)), vkeep);
+        __m128 v = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(vy + i), _mm_mul_ps(gy, active)), vkeep);
+        __m128 t = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(vz + i), _mm_mul_ps(gz, active)), vkeep);
+        _mm_storeu_ps(vx + i, u);
+        _mm_storeu_ps(vy + i, v);
+        _mm_storeu_ps(vz + i, t);
+        _mm_storeu_ps(x + i, _mm_add_ps(_mm_loadu_ps(x + i), _mm_mul_ps(_mm_mul_ps(u, vdt), active)));
+        _mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(_mm_mul_ps(v, vdt), active)));
+        _mm_storeu_ps(z + i, _mm_add_ps(_mm_loadu_ps(z + i), _mm_mul_ps(_mm_mul_ps(t, vdt), active)));
+    }
+    scalar().integrate(p, i, end, accel, keep, dt);
+}
+
+SIMD_TARGET("sse4.2")
+static void update_velocity_sse42(ClothParticles& p, const float* prev_x, const float* prev_y,
+    const float* prev_z, int begin, int end, float inv_h) {
+    const __m128 k = _mm_set1_ps(inv_h);
+    int i = begin;
+    for (; i + 4 <= end; i += 4) {
+        _mm_storeu_ps(&p.vx[i], _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&p.x[i]), _mm_loadu_ps(prev_x + i)), k));
+        _mm_storeu_ps(&p.vy[i], _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&p.y[i]), _mm_loadu_ps(prev_y + i)), k));
+        _mm_storeu_ps(&p.vz[i], _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&p.z[i]), _mm_loadu_ps(prev_z + i)), k));
+    }
+    scalar().update_velocity(p, prev_x, prev_y, prev_z, i, end, inv_h);
+}
+
+SIMD_TARGET("sse4.2")
+static void project_distance_sse42(ClothParticles& p, DistanceConstraints& c,
+    int begin, int end, float alpha) {
+    float* x = p.x.data();
+    float* y = p.y.data();
+    float* z = p.z.data();
+    const float* w = p.inv_mass.data();
+    const int* a = c.a.data();
+    const int* b = c.b.data();
+    const __m128 valpha = _mm_set1_ps(alpha);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 eps = _mm_set1_ps(1e-18f);
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    alignas(16) float out[6][4];
+
+    int k = begin;
+    for (; k + 4 <= end; k += 4) {
+        const int* i = a + k;
+        const int* j = b + k;
+        __m128 wi = _mm_setr_ps(w[i[0]], w[i[1]], w[i[2]], w[i[3]]);
+        __m128 wj = _mm_setr_ps(w[j[0]], w[j[1]], w[j[2]], w[j[3]]);
+        __m128 xi = _mm_setr_ps(x[i[0]], x[i[1]], x[i[2]], x[i[3]]);
+        __m128 yi = _mm_setr_ps(y[i[0]], y[i[1]], y[i[2]], y[i[3]]);
+        __m128 zi = _mm_setr_ps(z[i[0]], z[i[1]], z[i[2]], z[i[3]]);
+        __m128 xj = _mm_setr_ps(x[j[0]], x[j[1]], x[j[2]], x[j[3]]);
+        __m128 yj = _mm_setr_ps(y[j[0]], y[j[1]], y[j[2]], y[j[3]]);
+        __m128 zj = _mm_setr_ps(z[j[0]], z[j[1]], z[j[2]], z[j[3]]);
+
+        __m128 wsum = _mm_add_ps(wi, wj);
+        __m128 dx = _mm_sub_ps(xi, xj);
+        __m128 dy = _mm_sub_ps(yi, yj);
+        __m128 dz = _mm_sub_ps(zi, zj);
+        __m128 len2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+        __m128 valid = _mm_and_ps(_mm_cmpneq_ps(wsum, zero), _mm_cmpge_ps(len2, eps));
+        __m128 inv_len = _mm_div_ps(one, _mm_sqrt_ps(len2));
+
+        __m128 C = _mm_sub_ps(_mm_mul_ps(len2, inv_len), _mm_loadu_ps(&c.rest[k]));
+        __m128 lambda = _mm_loadu_ps(&c.lambda[k]);
+        __m128 dl = _mm_div_ps(_mm_sub_ps(_mm_xor_ps(C, sign), _mm_mul_ps(valpha, lambda)),
+            _mm_add_ps(wsum, valpha));
+        dl = _mm_and_ps(dl, valid);
+        _mm_storeu_ps(&c.lambda[k], _mm_add_ps(lambda, dl));
+
+        __m128 s = _mm_and_ps(_mm_mul_ps(dl, inv_len), valid);
+        __m128 si = _mm_mul_ps(wi, s);
+        __m128 sj = _mm_mul_ps(wj, s);
+        _mm_store_ps(out[0], _mm_add_ps(xi, _mm_mul_ps(si, dx)));
+        _mm_store_ps(out[1], _mm_add_ps(yi, _mm_mul_ps(si, dy)));
+        _mm_store_ps(out[2], _mm_add_ps(zi, _mm_mul_ps(si, dz)));
+        _mm_store_ps(out[3], _mm_sub_ps(xj, _mm_mul_ps(sj, dx)));
+        _mm_store_ps(out[4], _mm_sub_ps(yj, _mm_mul_ps(sj, dy)));
+        _mm_store_ps(out[5], _mm_sub_ps(zj, _mm_mul_ps(sj, dz)));
+        for (int l = 0; l < 4; ++l) {
+            x[i[l]] = out[0][l]; y[i[l]] = out[1][l]; z[i[l]] = out[2][l];
+            x[j[l]] = out[3][l]; y[j[l]] = out[4][l]; z[j[l]] = out[5][l];
+        }
+    }
+    scalar().project_distance(p, c, k, end, alpha);
+}
+
+// AVX2: 8 particles per instruction
+
+SIMD_TARGET("avx2")
+static void integrate_avx2(ClothParticles& p, int begin, int end,
+    const float accel[3], float keep, float dt) {
+    float* x = p.x.data();
+    float* y = p.y.data();
+    float* z = p.z.data();
+    float* vx = p.vx.data();
+    float* vy = p.vy.data();
+    float* vz = p.vz.data();
+    const float* w = p.inv_mass.data();
+    const __m256 gx = _mm256_set1_ps(accel[0] * dt);
+    const __m256 gy = _mm256_set1_ps(accel[1] * dt);
+    const __m256 gz = _mm256_set1_ps(accel[2] * dt);
+    const __m256 vkeep = _mm256_set1_ps(keep);
+    const __m256 vdt = _mm256_set1_ps(dt);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+
+    int i = begin;
+    for (; i + 8 <= end; i += 8) {
+        __m256 active = _mm256_and_ps(_mm256_cmp_ps(_mm256_loadu_ps(w + i), zero, _CMP_GT_OQ), one);
+        __m256 u = _mm256_mul_ps(_mm256_add_ps(_mm256_loadu_ps(vx + i), _mm256_mul_ps(gx, active)), vkeep);
+        __m256 v = _mm256_mul_ps(_mm256_add_ps(_mm256_loadu_ps(vy + i), _mm256_mul_ps(gy, active)), vkeep);
+        __m256 t = _mm256_mul_ps(_mm256_add_ps(_mm256_loadu_ps(vz + i), _mm256_mul_ps(gz, active)), vkeep);
+        _mm256_storeu_ps(vx + i, u);
+        _mm256_storeu_ps(vy + i, v);
+        _mm256_storeu_ps(vz + i, t);
+        _mm256_storeu_ps(x + i, _mm256_add_ps(_mm256_loadu_ps(x + i), _mm256_mul_ps(_mm256_mul_ps(u, vdt), active)));
+        _mm256_storeu_ps(y + i, _mm256_add_ps(_mm256_loadu_ps(y + i), _mm256_mul_ps(_mm256_mul_ps(v, vdt), active)));
+        _mm256_storeu_ps(z + i, _mm256_add_ps(_mm256_loadu_ps(z + i), _mm256_mul_ps(_mm256_mul_ps(t, vdt), active)));
+    }
+    scalar().integrate(p, i, end, accel, keep, dt);
+}
+
+SIMD_TARGET("avx2")
+static void update_velocity_avx2(ClothParticles& p, const float* prev_x, const float* prev_y,
+    const float* prev_z, int begin, int end, float inv_h) {
+    const __m256 k = _mm256_set1_ps(inv_h);
+    int i = begin;
+    for (; i + 8 <= end; i += 8) {
+        _mm256_storeu_ps(&p.vx[i], _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(&p.x[i]), _mm256_loadu_ps(prev_x + i)), k));
+        _mm256_storeu_ps(&p.vy[i], _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(&p.y[i]), _mm256_loadu_ps(prev_y + i)), k));
+        _mm256_storeu_ps(&p.vz[i], _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(&p.z[i]), _mm256_loadu_ps(prev_z + i)), k));
+    }
+    scalar().update_velocity(p, prev_x, prev_y, prev_z, i, end, inv_h);
+}
+
+SIMD_TARGET("avx2")
+static void project_distance_avx2(ClothParticles& p, DistanceConstraints& c,
+    int begin, int end, float alpha) {
+    float* x = p.x.data();
+    float* y = p.y.data();
+    float* z = p.z.data();
+    const float* w = p.inv_mass.data();
+    const int* a = c.a.data();
+    const int* b = c.b.data();
+    const __m256 valpha = _mm256_set1_ps(alpha);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 eps = _mm256_set1_ps(1e-18f);
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+    alignas(32) float out[6][8];
+
+    int k = begin;
+    for (; k + 8 <= end; k += 8) {
+        const int* i = a + k;
+        const int* j = b + k;
+        __m256i ia = _mm256_loadu_si256((const __m256i*)i);
+        __m256i ib = _mm256_loadu_si256((const __m256i*)j);
+        __m256 wi = _mm256_i32gather_ps(w, ia, 4);
+        __m256 wj = _mm256_i32gather_ps(w, ib, 4);
+        __m256 xi = _mm256_i32gather_ps(x, ia, 4);
+        __m256 yi = _mm256_i32gather_ps(y, ia, 4);
+        __m256 zi = _mm256_i32gather_ps(z, ia, 4);
+        __m256 xj = _mm256_i32gather_ps(x, ib, 4);
+        __m256 yj = _mm256_i32gather_ps(y, ib, 4);
+        __m256 zj = _mm256_i32gather_ps(z, ib, 4);
+
+        __m256 wsum = _mm256_add_ps(wi, wj);
+        __m256 dx = _mm256_sub_ps(xi, xj);
+        __m256 dy = _mm256_sub_ps(yi, yj);
+        __m256 dz = _mm256_sub_ps(zi, zj);
+        __m256 len2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+        __m256 valid = _mm256_and_ps(_mm256_cmp_ps(wsum, zero, _CMP_NEQ_UQ), _mm256_cmp_ps(len2, eps, _CMP_GE_OQ));
+        __m256 inv_len = _mm256_div_ps(one, _mm256_sqrt_ps(len2));
+
+        __m256 C = _mm256_sub_ps(_mm256_mul_ps(len2, inv_len), _mm256_loadu_ps(&c.rest[k]));
+        __m256 lambda = _mm256_loadu_ps(&c.lambda[k]);
+        __m256 dl = _mm256_div_ps(_mm256_sub_ps(_mm256_xor_ps(C, sign), _mm256_mul_ps(valpha, lambda)),
+            _mm256_add_ps(wsum, valpha));
+        dl = _mm256_and_ps(dl, valid);
+        _mm256_storeu_ps(&c.lambda[k], _mm256_add_ps(lambda, dl));
+
+        __m256 s = _mm256_and_ps(_mm256_mul_ps(dl, inv_len), valid);
+        __m256 si = _mm256_mul_ps(wi, s);
+        __m256 sj = _mm256_mul_ps(wj, s);
+        _mm256_store_ps(out[0], _mm256_add_ps(xi, _mm256_mul_ps(si, dx)));
+        _mm256_store_ps(out[1], _mm256_add_ps(yi, _mm256_mul_ps(si, dy)));
+        _mm256_store_ps(out[2], _mm256_add_ps(zi, _mm256_mul_ps(si, dz)));
+        _mm256_store_ps(out[3], _mm256_sub_ps(xj, _mm256_mul_ps(sj, dx)));
+        _mm256_store_ps(out[4], _mm256_sub_ps(yj, _mm256_mul_ps(sj, dy)));
+        _mm256_store_ps(out[5], _mm256_sub_ps(zj, _mm256_mul_ps(sj, dz)));
+        // AVX2 has no scatter
+        for (int l = 0; l < 8; ++l) {
+            x[i[l]] = out[0][l]; y[i[l]] = out[1][l]; z[i[l]] = out[2][l];
+            x[j[l]] = out[3][l]; y[j[l]] = out[4][l]; z[j[l]] = out[5][l];
+        }
+    }
+    scalar().project_distance(p, c, k, end, alpha);
+}
+
+// AVX-512: 16 particles per instruction
+
+SIMD_TARGET("avx512f")
+static void integrate_avx512(ClothParticles& p, int begin, int end,
+    const float accel[3], float keep, float dt) {
+    float* x = p.x.data();
+    float* y = p.y.data();
+    float* z = p.z.data();
+    float* vx = p.vx.data();
+    float* vy = p.vy.data();
+    float* vz = p.vz.data();
+    const float* w = p.inv_mass.data();
+    const __m512 gx = _mm512_set1_ps(accel[0] * dt);
+    const __m512 gy = _mm512_set1_ps(accel[1] * dt);
+    const __m512 gz = _mm512_set1_ps(accel[2] * dt);
+    const __m512 vkeep = _mm512_set1_ps(keep);
+    const __m512 vdt = _mm512_set1_ps(dt);
+    const __m512 zero = _mm512_setzero_ps();
+    const __m512 one = _mm512_set1_ps(1.0f);
+
+    int i = begin;
+    for (; i + 16 <= end; i += 16) {
+        __mmask16 m = _mm512_cmp_ps_mask(_mm512_loadu_ps(w + i), zero, _CMP_GT_OQ);
+        __m512 active = _mm512_maskz_mov_ps(m, one);
+        __m512 u = _mm512_mul_ps(_mm512_add_ps(_mm512_loadu_ps(vx + i), _mm512_mul_ps(gx, active)), vkeep);
+        __m512 v = _mm512_mul_ps(_mm512_add_ps(_mm512_loadu_ps(vy + i), _mm512_mul_ps(gy, active)), vkeep);
+        __m512 t = _mm512_mul_ps(_mm512_add_ps(_mm512_loadu_ps(vz + i), _mm512_mul_ps(gz, active)), vkeep);
+        _mm512_storeu_ps(vx + i, u);
+        _mm512_storeu_ps(vy + i, v);
+        _mm512_storeu_ps(vz + i, t);
+        _mm512_storeu_ps(x + i, _mm512_add_ps(_mm512_loadu_ps(x + i), _mm512_mul_ps(_mm512_mul_ps(u, vdt), active)));
+        _mm512_storeu_ps(y + i, _mm512_add_ps(_mm512_loadu_ps(y + i), _mm512_mul_ps(_mm512_mul_ps(v, vdt), active)));
+        _mm512_storeu_ps(z + i, _mm512_add_ps(_mm512_loadu_ps(z + i), _mm512_mul_ps(_mm512_mul_ps(t, vdt), active)));
+    }
+    scalar().integrate(p, i, end, accel, keep, dt);
+}
+
+SIMD_TARGET("avx512f")
+static void update_velocity_avx512(ClothParticles& p, const float* prev_x, const float* prev_y,
+    const float* prev_z, int begin, int end, float inv_h) {
+    const __m512 k = _mm512_set1_ps(inv_h);
+    int i = begin;
+    for (; i + 16 <= end; i += 16) {
+        _mm512_storeu_ps(&p.vx[i], _mm512_mul_ps(_mm512_sub_ps(_mm512_loadu_ps(&p.x[i]), _mm512_loadu_ps(prev_x + i)), k));
+        _mm512_storeu_ps(&p.vy[i], _mm512_mul_ps(_mm512_sub_ps(_mm512_loadu_ps(&p.y[i]), _mm512_loadu_ps(prev_y + i)), k));
+        _mm512_storeu_ps(&p.vz[i], _mm512_mul_ps(_mm512_sub_ps(_mm512_loadu_ps(&p.z[i]), _mm512_loadu_ps(prev_z + i)), k));
+    }
+    scalar().update_velocity(p, prev_x, prev_y, prev_z, i, end, inv_h);
+}
+
+SIMD_TARGET("avx512f")
+static void project_distance_avx512(ClothParticles& p, DistanceConstraints& c,
+    int begin, int end, float alpha) {
+    float* x = p.x.data();
+    float* y = p.y.data();
+    float* z = p.z.data();
+    const float* w = p.inv_mass.data();
+    const int* a = c.a.data();
+    const int* b = c.b.data();
+    const __m512 valpha = _mm512_set1_ps(alpha);
+    const __m512 zero = _mm512_setzero_ps();
+    const __m512 one = _mm512_set1_ps(1.0f);
+    const __m512 eps = _mm512_set1_ps(1e-18f);
+
+    int k = begin;
+    for (; k + 16 <= end; k += 16) {
+        __m512i ia = _mm512_loadu_si512(a + k);
+        __m512i ib = _mm512_loadu_si512(b + k);
+        __m512 wi = _mm512_i32gather_ps(ia, w, 4);
+        __m512 wj = _mm512_i32gather_ps(ib, w, 4);
+        __m512 xi = _mm512_i32gather_ps(ia, x, 4);
+        __m512 yi = _mm512_i32gather_ps(ia, y, 4);
+        __m512 zi = _mm512_i32gather_ps(ia, z, 4);
+        __m512 xj = _mm512_i32gather_ps(ib, x, 4);
+        __m512 yj = _mm512_i32gather_ps(ib, y, 4);
+        __m512 zj = _mm512_i32gather_ps(ib, z, 4);
+
+        __m512 wsum = _mm512_add_ps(wi, wj);
+        __m512 dx = _mm512_sub_ps(xi, xj);
+        __m512 dy = _mm512_sub_ps(yi, yj);
+        __m512 dz = _mm512_sub_ps(zi, zj);
+        __m512 len2 = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(dx, dx), _mm512_mul_ps(dy, dy)), _mm512_mul_ps(dz, dz));
+        __mmask16 valid = _mm512_cmp_ps_mask(wsum, zero, _CMP_NEQ_UQ) & _mm512_cmp_ps_mask(len2, eps, _CMP_GE_OQ);
+        __m512 inv_len = _mm512_div_ps(one, _mm512_sqrt_ps(len2));
+
+        __m512 C = _mm512_sub_ps(_mm512_mul_ps(len2, inv_len), _mm512_loadu_ps(&c.rest[k]));
+        __m512 lambda = _mm512_loadu_ps(&c.lambda[k]);
+        __m512 dl = _mm512_div_ps(_mm512_sub_ps(_mm512_sub_ps(zero, C), _mm512_mul_ps(valpha, lambda)),
+            _mm512_add_ps(wsum, valpha));
+        dl = _mm512_maskz_mov_ps(valid, dl);
+        _mm512_storeu_ps(&c.lambda[k], _mm512_add_ps(lambda, dl));
+
+        __m512 s = _mm512_maskz_mov_ps(valid, _mm512_mul_ps(dl, inv_len));
+        __m512 si = _mm512_mul_ps(wi, s);
+        __m512 sj = _mm512_mul_ps(wj, s);
+        _mm512_i32scatter_ps(x, ia, _mm512_add_ps(xi, _mm512_mul_ps(si, dx)), 4);
+        _mm512_i32scatter_ps(y, ia, _mm512_add_ps(yi, _mm512_mul_ps(si, dy)), 4);
+        _mm512_i32scatter_ps(z, ia, _mm512_add_ps(zi, _mm512_mul_ps(si, dz)), 4);
+        _mm512_i32scatter_ps(x, ib, _mm512_sub_ps(xj, _mm512_mul_ps(sj, dx)), 4);
+        _mm512_i32scatter_ps(y, ib, _mm512_sub_ps(yj, _mm512_mul_ps(sj, dy)), 4);
+        _mm512_i32scatter_ps(z, ib, _mm512_sub_ps(zj, _mm512_mul_ps(sj, dz)), 4);
+    }
+    scalar().project_distance(p, c, k, end, alpha);
+}
+
+extern const ClothKernels sse42_kernels = {
+    ISA_SSE42, "sse4.2",
+    integrate_sse42,
+    update_velocity_sse42,
+    project_distance_sse42
+};
+
+extern const ClothKernels avx2_kernels = {
+    ISA_AVX2, "avx2",
+    integrate_avx2,
+    update_velocity_avx2,
+    project_distance_avx2
+};
+
+extern const ClothKernels avx512_kernels = {
+    ISA_AVX512, "avx512",
+    integrate_avx512,
+    update_velocity_avx512,
+    project_distance_avx512
+};
+
+#endif
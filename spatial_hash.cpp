@@ -0,0 +1,53 @@
+#include "spatial_hash.h"
+
+SpatialHash::SpatialHash(float cell_size) {
+    mask = 0;
+    set_cell_size(cell_size);
+}
+
+void SpatialHash::set_cell_size(float cell_size) {
+    this->cell_size = cell_size > 0.0f ? cell_size : 1.0f;
+    inv_cell = 1.0f / this->cell_size;
+}
+
+void SpatialHash::build(const float* x, const float* y, const float* z, int count, int stride) {
+    if (count < 0)
+        count = 0;
+
+    // about two buckets per point keeps the chains short
+    unsigned buckets = 1;
+    while (buckets < 2u * (unsigned)count)
+        buckets <<= 1;
+    mask = buckets - 1;
+
+    point_bucket.resize(count);
+    keys.resize(count);
+    start.assign(buckets + 1, 0);
+    for (int k = 0; k < count; ++k) {
+        const size_t s = (size_t)k * stride;
+        unsigned b = bucket(cell(x[s]), cell(y[s]), cell(z[s]));
+        point_bucket[k] = b;
+        ++start[b + 1];
+    }
+    for (unsigned b = 0; b < buckets; ++b)
+        start[b + 1] += start[b];
+
+    ids.resize(count);
+    sx.resize(count);
+    sy.resize(count);
+    sz.resize(count);
+    // start[b] is used as the write cursor of bucket b and ends up at the
+    // start of bucket b + 1, so shift it back afterwards
+    for (int k = 0; k < count; ++k) {
+        const size_t s = (size_t)k * stride;
+        int m = start[point_bucket[k]]++;
+        ids[m] = k;
+        keys[m] = key(cell(x[s]), cell(y[s]), cell(z[s]));
+        sx[m] = x[s];
+        sy[m] = y[s];
+        sz[m] = z[s];
+    }
+    for (unsigned b = buckets; b > 0; --b)
+        start[b] = start[b - 1];
+    start[0] = 0;
+}
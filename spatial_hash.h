@@ -0,0 +1,134 @@
+#ifndef SPATIAL_HASH_H
+#define SPATIAL_HASH_H
+
+#include <cmath>
+#include <vector>
+
+// Uniform grid of cubic cells hashed into a table of buckets, for finding
+// the points within a given radius of each other. The cell size should be
+// the interaction radius: every close pair then lies in the same or in
+// adjacent cells.
+//
+// build() sorts the points by bucket with a counting sort, O(n), and keeps a
+// copy of the positions in that order, so a query walks contiguous memory
+// instead of jumping around the caller's arrays. Rebuild after the points
+// move; with a roughly even spread every query costs O(1) and all pairs O(n).
+class SpatialHash {
+public:
+    explicit SpatialHash(float cell_size = 1.0f);
+
+    void set_cell_size(float cell_size);
+    float get_cell_size() const { return cell_size; }
+
+    // Point k is (x[k * stride], y[k * stride], z[k * stride]), so both
+    // separate arrays (stride 1) and interleaved xyz (stride 3) work.
+    void build(const float* x, const float* y, const float* z, int count, int stride = 1);
+
+    int size() const { return (int)ids.size(); }
+
+    // Calls fn(j, dist2) for every point j within radius of (px, py, pz).
+    // radius must not exceed the cell size.
+    template <class F>
+    void for_each_near(float px, float py, float pz, float radius, F fn) const;
+
+    // Calls fn(i, j, dist2) once for every pair of points closer than or
+    // exactly at radius. radius must not exceed the cell size.
+    template <class F>
+    void for_each_pair(float radius, F fn) const;
+
+private:
+    int cell(float v) const { return (int)std::floor(v * inv_cell); }
+    // Cell coordinates packed 21 bits each; identifies the cell of a point
+    // even when several cells share a bucket.
+    static unsigned long long key(int cx, int cy, int cz) {
+        const unsigned long long m = (1u << 21) - 1;
+        return ((unsigned long long)cx & m) | ((unsigned long long)cy & m) << 21 | ((unsigned long long)cz & m) << 42;
+    }
+    unsigned bucket(int cx, int cy, int cz) const {
+        return ((unsigned)cx * 73856093u ^ (unsigned)cy * 19349663u ^ (unsigned)cz * 83492791u) & mask;
+    }
+
+    float cell_size;
+    float inv_cell;
+    unsigned mask;                          // bucket count - 1, a power of two
+    std::vector<int> start;                 // first sorted point of every bucket, plus the end
+    std::vector<int> ids;                   // caller's index of every sorted point
+    std::vector<float> sx, sy, sz;          // positions in sorted order
+    std::vector<unsigned long long> keys;   // cell of every sorted point
+    std::vector<unsigned> point_bucket;     // scratch for build()
+};
+
+template <class F>
+void SpatialHash::for_each_near(float px, float py, float pz, float radius, F fn) const {
+    if (ids.empty())
+        return;
+    const float r2 = radius * radius;
+    const int cx = cell(px), cy = cell(py), cz = cell(pz);
+    for (int dz = -1; dz <= 1; ++dz) {
+        for (int dy = -1; dy <= 1; ++dy) {
+            for (int dx = -1; dx <= 1; ++dx) {
+                const unsigned b = bucket(cx + dx, cy + dy, cz + dz);
+                const unsigned long long k = key(cx + dx, cy + dy, cz + dz);
+                for (int m = start[b]; m < start[b + 1]; ++m) {
+                    if (keys[m] != k)
+                        continue;
+                    float ex = sx[m] - px, ey = sy[m] - py, ez = sz[m] - pz;
+                    float d2 = ex * ex + ey * ey + ez * ez;
+                    if (d2 <= r2)
+                        fn(ids[m], d2);
+                }
+            }
+        }
+    }
+}
+
+// Every pair is found once: within a cell from the point that comes first in
+// sorted order, between cells from the cell with the smaller offset, so only
+// 13 of the 26 neighbouring cells are visited. Runs of points in the same
+// cell look the neighbouring buckets up once.
+template <class F>
+void SpatialHash::for_each_pair(float radius, F fn) const {
+    const float r2 = radius * radius;
+    const int n = size();
+    unsigned buckets[13];
+    unsigned long long targets[13];
+    for (int k = 0; k < n; ++k) {
+        const float px = sx[k], py = sy[k], pz = sz[k];
+        const int cx = cell(px), cy = cell(py), cz = cell(pz);
+        if (k == 0 || keys[k] != keys[k - 1]) {
+            int count = 0;
+            for (int dz = 0; dz <= 1; ++dz) {
+                for (int dy = dz ? -1 : 0; dy <= 1; ++dy) {
+                    for (int dx = (dz || dy) ? -1 : 1; dx <= 1; ++dx) {
+                        buckets[count] = bucket(cx + dx, cy + dy, cz + dz);
+                        targets[count] = key(cx + dx, cy + dy, cz + dz);
+                        ++count;
+                    }
+                }
+            }
+        }
+
+        // own cell, later points only
+        const unsigned own = bucket(cx, cy, cz);
+        for (int m = k + 1; m < start[own + 1]; ++m) {
+            if (keys[m] != keys[k])
+                continue;
+            float dx = sx[m] - px, dy = sy[m] - py, dz = sz[m] - pz;
+            float d2 = dx * dx + dy * dy + dz * dz;
+            if (d2 <= r2)
+                fn(ids[k], ids[m], d2);
+        }
+        for (int c = 0; c < 13; ++c) {
+            for (int m = start[buckets[c]]; m < start[buckets[c] + 1]; ++m) {
+                if (keys[m] != targets[c])
+                    continue;
+                float dx = sx[m] - px, dy = sy[m] - py, dz = sz[m] - pz;
+                float d2 = dx * dx + dy * dy + dz * dz;
+                if (d2 <= r2)
+                    fn(ids[k], ids[m], d2);
+            }
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,125 @@
+#include "stream_buffer.h"
+#include <cstddef>
+#include <cstring>
+
+static bool buffer_storage_supported() {
+#ifdef GL_MAP_PERSISTENT_BIT
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    bool supported = major > 4 || (major == 4 && minor >= 4);
+    if (!supported) {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count && !supported; ++i) {
+            const char* name = (const char*)glGetStringi(GL_EXTENSIONS, (GLuint)i);
+            supported = name && strcmp(name, "GL_ARB_buffer_storage") == 0;
+        }
+    }
+    // the loader may not have the entry point even if the driver has it
+    return supported && glBufferStorage != NULL;
+#else
+    return false;
+#endif
+}
+
+StreamBuffer::StreamBuffer() {
+    buffer = 0;
+    size = 0;
+    current = 0;
+    persistent_map = false;
+    base = NULL;
+    stall_count = 0;
+}
+
+StreamBuffer::~StreamBuffer() {
+    release();
+}
+
+void StreamBuffer::init(GLsizeiptr region_size, int regions, bool allow_persistent) {
+    release();
+    size = (region_size + 255) & ~(GLsizeiptr)255;
+    fences.assign(regions > 0 ? regions : 1, (GLsync)0);
+    current = 0;
+
+    const GLsizeiptr total = size * (GLsizeiptr)fences.size();
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+#ifdef GL_MAP_PERSISTENT_BIT
+    if (allow_persistent && buffer_storage_supported()) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_ARRAY_BUFFER, total, NULL, flags);
+        base = (char*)glMapBufferRange(GL_ARRAY_BUFFER, 0, total, flags);
+        persistent_map = base != NULL;
+    }
+#endif
+    if (!persistent_map) {
+        // buffer storage is immutable, so start over with a fresh name
+        glDeleteBuffers(1, &buffer);
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        glBufferData(GL_ARRAY_BUFFER, total, NULL, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void StreamBuffer::release() {
+    for (size_t i = 0; i < fences.size(); ++i) {
+        if (fences[i])
+            glDeleteSync(fences[i]);
+    }
+    fences.clear();
+    if (buffer) {
+        if (persistent_map) {
+            glBindBuffer(GL_ARRAY_BUFFER, buffer);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+        glDeleteBuffers(1, &buffer);
+    }
+    buffer = 0;
+    base = NULL;
+    persistent_map = false;
+}
+
+void StreamBuffer::wait(int region) {
+    GLsync sync = fences[region];
+    if (!sync)
+        return;
+    GLenum status = glClientWaitSync(sync, 0, 0);
+    if (status == GL_TIMEOUT_EXPIRED) {
+        ++stall_count;
+        do {
+            status = glClientWaitSync(sync, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);   // 1 ms
+        } while (status == GL_TIMEOUT_EXPIRED);
+    }
+    glDeleteSync(sync);
+    fences[region] = 0;
+}
+
+void* StreamBuffer::map() {
+    if (!buffer)
+        return NULL;
+    wait(current);
+    const GLintptr offset = size * current;
+    if (persistent_map)
+        return base + offset;
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    return glMapBufferRange(GL_ARRAY_BUFFER, offset, size,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+}
+
+GLintptr StreamBuffer::unmap() {
+    if (!persistent_map && buffer) {
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+    }
+    return size * current;
+}
+
+void StreamBuffer::fence() {
+    if (!buffer)
+        return;
+    fences[current] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    current = (current + 1) % (int)fences.size();
+}
@@ -0,0 +1,63 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <glad/glad.h>
+#include <vector>
+
+// Vertex buffer for data rewritten every frame, split into a ring of
+// regions (three by default). Each frame writes one region through a
+// pointer into the buffer itself, while the GPU may still be reading the
+// regions of earlier frames:
+//
+//     float* dst = (float*)stream.map();     // write the frame's data here
+//     ...
+//     GLintptr offset = stream.unmap();      // region start in the buffer
+//     glVertexAttribPointer(..., (void*)offset);
+//     glDraw...(...);
+//     stream.fence();                        // after the draws reading it
+//
+// With GL 4.4 or ARB_buffer_storage the whole buffer is mapped once,
+// persistently and coherently, and map()/unmap() make no GL calls. Without
+// it every region is mapped with GL_MAP_UNSYNCHRONIZED_BIT. Either way the
+// driver does not synchronize: a fence placed after the draws tells map()
+// when the GPU is done with a region, and map() only waits if the GPU is
+// a whole ring of frames behind.
+class StreamBuffer {
+public:
+    StreamBuffer();
+    ~StreamBuffer();
+
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    // Needs a current GL 3.3 context. region_size is rounded up to 256
+    // bytes. allow_persistent = false forces the glMapBufferRange path.
+    void init(GLsizeiptr region_size, int regions = 3, bool allow_persistent = true);
+    void release();
+
+    // Write-only pointer to the next region, region_size() bytes.
+    void* map();
+    // Ends the writes; returns the byte offset of the region in id().
+    GLintptr unmap();
+    // Marks the region as in use by the draw calls issued since unmap().
+    void fence();
+
+    GLuint id() const { return buffer; }
+    GLsizeiptr region_size() const { return size; }
+    bool persistent() const { return persistent_map; }
+    // Times map() had to wait for the GPU, for profiling.
+    long long stalls() const { return stall_count; }
+
+private:
+    void wait(int region);
+
+    GLuint buffer;
+    GLsizeiptr size;            // of one region
+    int current;
+    bool persistent_map;
+    char* base;                 // whole buffer when persistent_map
+    std::vector<GLsync> fences;
+    long long stall_count;
+};
+
+#endif
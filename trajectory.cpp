@@ -0,0 +1,415 @@
+#include "trajectory.h"
+#include "cloth_solver.h"
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char MAGIC[8] = { 'C', 'L', 'O', 'T', 'H', 'T', 'R', 'J' };
+static const uint32_t VERSION = 1;
+static const uint64_t ALIGN = 64;
+// The file grows by at least this much, so growing is rare.
+static const uint64_t GROW_BYTES = 64ull << 20;
+
+static uint64_t align_up(uint64_t v) {
+    return (v + ALIGN - 1) / ALIGN * ALIGN;
+}
+
+// The mapping helpers below keep a MappedFile either fully open or fully
+// closed. map_resize maps the new size before letting go of the old view,
+// so when it fails the file stays open and mapped with the frames in it.
+
+#ifdef _WIN32
+
+static bool map_view(MappedFile& f, size_t size) {
+    DWORD protect = f.writable ? PAGE_READWRITE : PAGE_READONLY;
+    f.mapping = CreateFileMappingA(f.file, NULL, protect,
+        (DWORD)((uint64_t)size >> 32), (DWORD)(size & 0xffffffffu), NULL);
+    if (!f.mapping)
+        return false;
+    f.data = MapViewOfFile(f.mapping, f.writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, size);
+    if (!f.data) {
+        CloseHandle(f.mapping);
+        f.mapping = NULL;
+        return false;
+    }
+    f.size = size;
+    return true;
+}
+
+static void unmap_view(MappedFile& f) {
+    if (f.data)
+        UnmapViewOfFile(f.data);
+    if (f.mapping)
+        CloseHandle(f.mapping);
+    f.data = NULL;
+    f.mapping = NULL;
+    f.size = 0;
+}
+
+static void map_close(MappedFile& f, uint64_t keep) {
+    unmap_view(f);
+    if (f.file) {
+        if (f.writable) {
+            LARGE_INTEGER end;
+            end.QuadPart = (LONGLONG)keep;
+            SetFilePointerEx(f.file, end, NULL, FILE_BEGIN);
+            SetEndOfFile(f.file);
+        }
+        CloseHandle(f.file);
+    }
+    f.file = NULL;
+}
+
+static bool map_create(MappedFile& f, const char* path, size_t size) {
+    f.writable = true;
+    f.file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL,
+        CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (f.file == INVALID_HANDLE_VALUE) {
+        f.file = NULL;
+        return false;
+    }
+    if (!map_view(f, size)) {
+        map_close(f, 0);
+        return false;
+    }
+    return true;
+}
+
+static bool map_open_read(MappedFile& f, const char* path) {
+    f.writable = false;
+    f.file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (f.file == INVALID_HANDLE_VALUE) {
+        f.file = NULL;
+        return false;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(f.file, &size) || size.QuadPart <= 0 || !map_view(f, (size_t)size.QuadPart)) {
+        map_close(f, 0);
+        return false;
+    }
+    return true;
+}
+
+// CreateFileMapping extends the file to the new size by itself; close
+// cuts it back if the view of the new size then fails.
+static bool map_resize(MappedFile& f, size_t size) {
+    MappedFile grown = f;
+    grown.data = NULL;
+    grown.mapping = NULL;
+    if (!map_view(grown, size))
+        return false;
+    unmap_view(f);
+    f = grown;
+    return true;
+}
+
+#else
+
+static void map_close(MappedFile& f, uint64_t keep) {
+    if (f.data)
+        munmap(f.data, f.size);
+    if (f.fd >= 0) {
+        if (f.writable && ftruncate(f.fd, (off_t)keep) != 0) {
+            // the file keeps its unused tail; readers go by the header
+        }
+        ::close(f.fd);
+    }
+    f.data = nullptr;
+    f.size = 0;
+    f.fd = -1;
+}
+
+static bool map_view(MappedFile& f, size_t size) {
+    int prot = f.writable ? PROT_READ | PROT_WRITE : PROT_READ;
+    void* data = mmap(NULL, size, prot, MAP_SHARED, f.fd, 0);
+    if (data == MAP_FAILED)
+        return false;
+    f.data = data;
+    f.size = size;
+    return true;
+}
+
+static bool map_create(MappedFile& f, const char* path, size_t size) {
+    f.writable = true;
+    f.fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (f.fd < 0)
+        return false;
+    if (ftruncate(f.fd, (off_t)size) != 0 || !map_view(f, size)) {
+        map_close(f, 0);
+        return false;
+    }
+    return true;
+}
+
+static bool map_open_read(MappedFile& f, const char* path) {
+    f.writable = false;
+    f.fd = ::open(path, O_RDONLY);
+    if (f.fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(f.fd, &st) != 0 || st.st_size <= 0 || !map_view(f, (size_t)st.st_size)) {
+        map_close(f, 0);
+        return false;
+    }
+    return true;
+}
+
+static bool map_resize(MappedFile& f, size_t size) {
+    void* data = MAP_FAILED;
+    if (ftruncate(f.fd, (off_t)size) == 0)
+        data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, f.fd, 0);
+    if (data == MAP_FAILED) {
+        if (ftruncate(f.fd, (off_t)f.size) != 0) {
+            // the file keeps the tail; close cuts it
+        }
+        return false;
+    }
+    munmap(f.data, f.size);
+    f.data = data;
+    f.size = size;
+    return true;
+}
+
+#endif
+
+TrajectoryRecorder::TrajectoryRecorder() {
+    opened = false;
+    capacity = 0;
+    stride = 0;
+    queued = 0;
+    particles = 0;
+    flags = 0;
+    busy = 0;
+    failed = false;
+    quit = false;
+}
+
+TrajectoryRecorder::~TrajectoryRecorder() {
+    close();
+}
+
+bool TrajectoryRecorder::open(const char* path, int rows, int cols, unsigned flags) {
+    close();
+    if (rows <= 0 || cols <= 0)
+        return false;
+
+    this->flags = flags | TRAJECTORY_POSITIONS;
+    particles = rows * cols;
+    int arrays = (this->flags & TRAJECTORY_VELOCITIES) ? 6 : 3;
+    stride = align_up(sizeof(TrajectoryFrameHeader) + (uint64_t)arrays * particles * sizeof(float));
+
+    const uint64_t offset = align_up(sizeof(TrajectoryHeader));
+    capacity = GROW_BYTES / stride > 16 ? GROW_BYTES / stride : 16;
+    if (!map_create(file, path, (size_t)(offset + capacity * stride)))
+        return false;
+
+    TrajectoryHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.flags = this->flags;
+    header.rows = (uint32_t)rows;
+    header.cols = (uint32_t)cols;
+    header.frame_stride = stride;
+    header.frame_count = 0;
+    header.data_offset = offset;
+    memcpy(file.data, &header, sizeof(header));
+
+    buffers.assign(BUFFERS, Staging());
+    free_buffers.clear();
+    pending.clear();
+    for (int i = 0; i < BUFFERS; ++i) {
+        buffers[i].data.resize((size_t)arrays * particles);
+        free_buffers.push_back(i);
+    }
+    queued = 0;
+    busy = 0;
+    failed = false;
+    quit = false;
+    opened = true;
+    thread = std::thread(&TrajectoryRecorder::writer, this);
+    return true;
+}
+
+// Doubles the capacity, but adds at most a gigabyte at a time.
+bool TrajectoryRecorder::reserve(uint64_t frames) {
+    if (frames <= capacity)
+        return true;
+    uint64_t grow = capacity;
+    if (grow * stride > (1ull << 30))
+        grow = (1ull << 30) / stride + 1;
+    uint64_t next = capacity + grow > frames ? capacity + grow : frames;
+
+    const uint64_t offset = align_up(sizeof(TrajectoryHeader));
+    if (!map_resize(file, (size_t)(offset + next * stride)))
+        return false;
+    capacity = next;
+    return true;
+}
+
+bool TrajectoryRecorder::append(const ClothParticles& p, double time) {
+    if (!opened || p.size() != particles)
+        return false;
+
+    int b;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [this] { return !free_buffers.empty() || failed; });
+        if (failed)
+            return false;
+        b = free_buffers.front();
+        free_buffers.pop_front();
+    }
+
+    Staging& s = buffers[b];
+    s.time = time;
+    s.index = queued++;
+    float* out = s.data.data();
+    std::copy(p.x.begin(), p.x.end(), out);
+    std::copy(p.y.begin(), p.y.end(), out + particles);
+    std::copy(p.z.begin(), p.z.end(), out + 2 * particles);
+    if (flags & TRAJECTORY_VELOCITIES) {
+        std::copy(p.vx.begin(), p.vx.end(), out + 3 * particles);
+        std::copy(p.vy.begin(), p.vy.end(), out + 4 * particles);
+        std::copy(p.vz.begin(), p.vz.end(), out + 5 * particles);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.push_back(b);
+    }
+    changed.notify_all();
+    return true;
+}
+
+// Runs on the writer thread; the mapping is only touched here while the
+// recorder is open.
+void TrajectoryRecorder::write(const Staging& s) {
+    TrajectoryHeader* header = (TrajectoryHeader*)file.data;
+    char* frame = (char*)file.data + header->data_offset + s.index * stride;
+    TrajectoryFrameHeader fh;
+    fh.time = s.time;
+    fh.index = s.index;
+    memcpy(frame, &fh, sizeof(fh));
+    memcpy(frame + sizeof(fh), s.data.data(), s.data.size() * sizeof(float));
+    header->frame_count = s.index + 1;
+}
+
+void TrajectoryRecorder::writer() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        changed.wait(lock, [this] { return quit || !pending.empty(); });
+        if (pending.empty())
+            return;
+        int b = pending.front();
+        pending.pop_front();
+        ++busy;
+        lock.unlock();
+
+        bool ok = !failed && reserve(buffers[b].index + 1);
+        if (ok)
+            write(buffers[b]);
+
+        lock.lock();
+        if (!ok)
+            failed = true;
+        --busy;
+        free_buffers.push_back(b);
+        changed.notify_all();
+    }
+}
+
+void TrajectoryRecorder::flush() {
+    if (!opened)
+        return;
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [this] { return pending.empty() && busy == 0; });
+}
+
+void TrajectoryRecorder::close() {
+    if (!opened)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    changed.notify_all();
+    thread.join();
+
+    uint64_t used = 0;
+    if (file.data) {
+        const TrajectoryHeader* header = (const TrajectoryHeader*)file.data;
+        used = header->data_offset + header->frame_count * stride;
+    }
+    map_close(file, used);
+    buffers.clear();
+    capacity = 0;
+    opened = false;
+}
+
+TrajectoryReader::TrajectoryReader() {
+    header = nullptr;
+    frames = 0;
+}
+
+TrajectoryReader::~TrajectoryReader() {
+    close();
+}
+
+bool TrajectoryReader::open(const char* path) {
+    close();
+    if (!map_open_read(file, path))
+        return false;
+
+    const TrajectoryHeader* h = (const TrajectoryHeader*)file.data;
+    bool valid = file.size >= sizeof(TrajectoryHeader) &&
+        memcmp(h->magic, MAGIC, sizeof(MAGIC)) == 0 && h->version == VERSION &&
+        h->rows > 0 && h->cols > 0 && h->data_offset >= sizeof(TrajectoryHeader);
+    if (valid) {
+        int arrays = (h->flags & TRAJECTORY_VELOCITIES) ? 6 : 3;
+        uint64_t need = sizeof(TrajectoryFrameHeader) + (uint64_t)arrays * h->rows * h->cols * sizeof(float);
+        valid = h->frame_stride >= need && h->data_offset <= file.size &&
+            h->frame_count <= (file.size - h->data_offset) / h->frame_stride;
+    }
+    if (!valid) {
+        map_close(file, 0);
+        return false;
+    }
+    header = h;
+    frames = h->frame_count;
+    return true;
+}
+
+void TrajectoryReader::close() {
+    map_close(file, 0);
+    header = nullptr;
+    frames = 0;
+}
+
+TrajectoryReader::Frame TrajectoryReader::frame(uint64_t k) const {
+    const char* base = (const char*)file.data + header->data_offset + k * header->frame_stride;
+    const size_t n = (size_t)header->rows * header->cols;
+    const float* arrays = (const float*)(base + sizeof(TrajectoryFrameHeader));
+    const bool velocities = (header->flags & TRAJECTORY_VELOCITIES) != 0;
+
+    Frame f;
+    f.time = ((const TrajectoryFrameHeader*)base)->time;
+    f.x = arrays;
+    f.y = arrays + n;
+    f.z = arrays + 2 * n;
+    f.vx = velocities ? arrays + 3 * n : nullptr;
+    f.vy = velocities ? arrays + 4 * n : nullptr;
+    f.vz = velocities ? arrays + 5 * n : nullptr;
+    return f;
+}
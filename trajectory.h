@@ -0,0 +1,156 @@
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct ClothParticles;
+
+// Trajectory file: a fixed header followed by frames that all have the same
+// size, so frame k starts at data_offset + k * frame_stride and any frame is
+// found without reading the ones before it. Every frame is a
+// TrajectoryFrameHeader and then the arrays x, y, z (and vx, vy, vz when
+// recorded), rows * cols floats each in particle order. Little endian, the
+// byte order of every machine we run on.
+struct TrajectoryHeader {
+    char magic[8];              // "CLOTHTRJ"
+    uint32_t version;
+    uint32_t flags;             // TRAJECTORY_* bits
+    uint32_t rows;
+    uint32_t cols;
+    uint64_t frame_stride;      // bytes per frame, a multiple of 64
+    uint64_t frame_count;       // written last, so it only counts whole frames
+    uint64_t data_offset;       // first frame, a multiple of 64
+    uint8_t reserved[16];
+};
+
+struct TrajectoryFrameHeader {
+    double time;                // simulated seconds
+    uint64_t index;             // frame number, for checking
+};
+
+enum {
+    TRAJECTORY_POSITIONS = 1,
+    TRAJECTORY_VELOCITIES = 2
+};
+
+// Platform file mapping, grown in large pieces.
+struct MappedFile {
+    void* data = nullptr;
+    size_t size = 0;
+    bool writable = false;
+#ifdef _WIN32
+    void* file = nullptr;
+    void* mapping = nullptr;
+#else
+    int fd = -1;
+#endif
+};
+
+// Appends frames to a memory-mapped trajectory file. append() only copies
+// the particles into one of a few staging buffers and returns; a writer
+// thread copies the buffers into the mapping, where first touching fresh
+// pages and growing the file cost far more than the copy itself, and the
+// operating system writes the pages to disk in the background. append()
+// waits only when the writer is a whole set of buffers behind. The file
+// grows by many frames at a time and is cut to the recorded frames by
+// close().
+class TrajectoryRecorder {
+public:
+    TrajectoryRecorder();
+    ~TrajectoryRecorder();
+
+    TrajectoryRecorder(const TrajectoryRecorder&) = delete;
+    TrajectoryRecorder& operator=(const TrajectoryRecorder&) = delete;
+
+    // Creates or truncates the file. flags picks the arrays; positions are
+    // always recorded.
+    bool open(const char* path, int rows, int cols, unsigned flags = TRAJECTORY_POSITIONS);
+    // Queues the particles as the next frame. False if the file is not
+    // open or could not grow; the frames before that are kept.
+    bool append(const ClothParticles& p, double time);
+    // Waits until every queued frame is in the mapping.
+    void flush();
+    // Flushes, then cuts the file to the recorded frames.
+    void close();
+
+    bool is_open() const { return opened; }
+    // Frames queued so far, written or not.
+    uint64_t frame_count() const { return queued; }
+
+private:
+    struct Staging {
+        double time;
+        uint64_t index;
+        std::vector<float> data;
+    };
+
+    bool reserve(uint64_t frames);
+    void write(const Staging& s);
+    void writer();
+
+    static const int BUFFERS = 4;
+
+    MappedFile file;
+    bool opened;
+    uint64_t capacity;          // frames that fit in the mapping
+    uint64_t stride;
+    uint64_t queued;
+    int particles;
+    unsigned flags;
+
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<Staging> buffers;
+    std::deque<int> free_buffers;
+    std::deque<int> pending;
+    int busy;                   // buffers taken by the writer
+    bool failed;                // the file could not grow
+    bool quit;
+};
+
+// Read-only view of a trajectory file, e.g. for playback.
+class TrajectoryReader {
+public:
+    struct Frame {
+        double time;
+        const float* x;
+        const float* y;
+        const float* z;
+        const float* vx;        // NULL without TRAJECTORY_VELOCITIES
+        const float* vy;
+        const float* vz;
+    };
+
+    TrajectoryReader();
+    ~TrajectoryReader();
+
+    TrajectoryReader(const TrajectoryReader&) = delete;
+    TrajectoryReader& operator=(const TrajectoryReader&) = delete;
+
+    // Fails on a missing file, a wrong magic or version, or a header that
+    // does not match the file size.
+    bool open(const char* path);
+    void close();
+
+    int rows() const { return header ? (int)header->rows : 0; }
+    int cols() const { return header ? (int)header->cols : 0; }
+    unsigned flags() const { return header ? header->flags : 0; }
+    uint64_t frame_count() const { return frames; }
+
+    // Frame k, 0 <= k < frame_count().
+    Frame frame(uint64_t k) const;
+
+private:
+    MappedFile file;
+    const TrajectoryHeader* header;
+    uint64_t frames;
+};
+
+#endif
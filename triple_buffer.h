@@ -0,0 +1,60 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+
+// Hands the newest of a stream of values from one writer thread to one
+// reader thread without locks, waits or copies. There are three slots: the
+// writer fills its back slot and publishes it, the reader reads its front
+// slot, and the third one sits between them holding the newest published
+// value. Publishing and taking the newest value each swap a slot with the
+// middle one in one atomic exchange:
+//
+//     // writer                          // reader
+//     Snapshot& s = buffer.write();      buffer.update();
+//     fill(s);                           const Snapshot& s = buffer.read();
+//     buffer.publish();                  draw(s);
+//
+// The writer never waits for the reader: values the reader has not taken
+// yet are replaced. The reader keeps its slot, untouched, until it calls
+// update() again. Slots are reused, so a writer assigning into vectors
+// stops allocating after the first rounds.
+template <class T>
+class TripleBuffer {
+public:
+    TripleBuffer() : middle(1) {
+        back = 0;
+        front = 2;
+    }
+
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    // Writer: the slot to fill, holding some older value.
+    T& write() { return slots[back]; }
+    // Writer: makes the filled slot the newest value.
+    void publish() {
+        back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX;
+    }
+
+    // Reader: moves to the newest value if one was published since the last
+    // call; false if read() stays the same.
+    bool update() {
+        if (!(middle.load(std::memory_order_relaxed) & FRESH))
+            return false;
+        front = middle.exchange(front, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+    // Reader: the value taken by the last update().
+    const T& read() const { return slots[front]; }
+
+private:
+    enum { INDEX = 3, FRESH = 4 };
+
+    T slots[3];
+    int back;                   // writer's slot
+    int front;                  // reader's slot
+    std::atomic<int> middle;    // index of the third slot, FRESH if not read yet
+};
+
+#endif
@@ -0,0 +1,45 @@
+#include "wireframe.h"
+
+const char* const wireframe_geometry_source = "#version 330 core\n"
+"layout (triangles) in;\n"
+"layout (triangle_strip, max_vertices = 3) out;\n"
+"uniform vec2 viewport;\n"
+"noperspective out vec3 edgeDistance;\n"
+"void main()\n"
+"{\n"
+"   // corners in pixels\n"
+"   vec2 p0 = 0.5 * viewport * gl_in[0].gl_Position.xy / gl_in[0].gl_Position.w;\n"
+"   vec2 p1 = 0.5 * viewport * gl_in[1].gl_Position.xy / gl_in[1].gl_Position.w;\n"
+"   vec2 p2 = 0.5 * viewport * gl_in[2].gl_Position.xy / gl_in[2].gl_Position.w;\n"
+"   vec2 e0 = p2 - p1;\n"
+"   vec2 e1 = p2 - p0;\n"
+"   vec2 e2 = p1 - p0;\n"
+"   // height of each corner over the opposite side: twice the area over its length\n"
+"   float area = abs(e1.x * e2.y - e1.y * e2.x);\n"
+"   vec3 h = area / max(vec3(length(e0), length(e1), length(e2)), 1e-6);\n"
+"   edgeDistance = vec3(h.x, 0.0, 0.0);\n"
+"   gl_Position = gl_in[0].gl_Position;\n"
+"   EmitVertex();\n"
+"   edgeDistance = vec3(0.0, h.y, 0.0);\n"
+"   gl_Position = gl_in[1].gl_Position;\n"
+"   EmitVertex();\n"
+"   edgeDistance = vec3(0.0, 0.0, h.z);\n"
+"   gl_Position = gl_in[2].gl_Position;\n"
+"   EmitVertex();\n"
+"   EndPrimitive();\n"
+"}\n";
+
+const char* const wireframe_fragment_source = "#version 330 core\n"
+"noperspective in vec3 edgeDistance;\n"
+"out vec4 FragColor;\n"
+"uniform vec4 fillColor;\n"
+"uniform vec4 wireColor;\n"
+"uniform float wireWidth;\n"
+"void main()\n"
+"{\n"
+"   // distances to the edges from the first corner; the third edge is not drawn\n"
+"   float d = min(edgeDistance.y, edgeDistance.z);\n"
+"   float half_width = 0.5 * wireWidth;\n"
+"   float wire = 1.0 - smoothstep(half_width - 0.5, half_width + 0.5, d);\n"
+"   FragColor = mix(fillColor, wireColor, wire);\n"
+"}\n";
@@ -0,0 +1,32 @@
+#ifndef WIREFRAME_H
+#define WIREFRAME_H
+
+// Geometry and fragment shader that draw a mesh filled and its edges over
+// it in the same draw call, instead of drawing it once filled and once more
+// as lines. Link them after any vertex shader that writes gl_Position:
+//
+//     program.build(vertexShaderSource, wireframe_geometry_source, wireframe_fragment_source);
+//     ...
+//     program.set(viewportLoc, (float)width, (float)height);
+//     program.set(fillLoc, r, g, b, 1.0f);
+//     program.set(wireLoc, 0.0f, 0.0f, 0.0f, 1.0f);
+//     program.set(widthLoc, 1.5f);
+//     lod.draw_triangles(level);
+//
+// Uniforms: viewport (vec2, pixels), fillColor and wireColor (vec4),
+// wireWidth (float, pixels).
+//
+// The geometry shader gives every fragment its distance in pixels to the
+// edges of its triangle, so lines keep the same width at any distance and
+// any slope, with a pixel of smoothing instead of aliasing. Each triangle
+// draws half of the line on its side of an edge.
+//
+// Only the two edges from the first vertex of each triangle are drawn, which
+// hides the quad diagonals of ParamMesh triangles (see ParamMesh). Edges on
+// the open border of a mesh come out half as wide. The distances are taken
+// after the perspective divide, so triangles crossing the plane of the eye
+// get wrong edges; the near plane clips them anyway for these scenes.
+extern const char* const wireframe_geometry_source;
+extern const char* const wireframe_fragment_source;
+
+#endif
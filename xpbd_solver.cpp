@@ -0,0 +1,224 @@
+#include "xpbd_solver.h"
+#include "cloth_solver.h"
+#include "simd_kernels.h"
+#include "job_system.h"
+#include "profiler.h"
+#include <algorithm>
+#include <cmath>
+
+void DistanceConstraints::clear() {
+    a.clear();
+    b.clear();
+    rest.clear();
+    lambda.clear();
+    colors.clear();
+}
+
+void DistanceConstraints::add(int a, int b, float rest) {
+    this->a.push_back(a);
+    this->b.push_back(b);
+    this->rest.push_back(rest);
+    lambda.push_back(0.0f);
+}
+
+void DistanceConstraints::begin_color() {
+    colors.push_back(size());
+}
+
+XpbdSolver::XpbdSolver() {
+    iterations = 1;
+    substeps = 4;
+    built = false;
+    collision_radius = 0.0f;
+    constraints[STRUCTURAL].compliance = 0.0f;
+    constraints[SHEAR].compliance = 1e-5f;
+    constraints[BENDING].compliance = 1e-3f;
+}
+
+void XpbdSolver::set_compliance(ConstraintType type, float compliance) {
+    constraints[type].compliance = compliance;
+}
+
+void XpbdSolver::set_substeps(int substeps) {
+    this->substeps = substeps > 0 ? substeps : 1;
+}
+
+float XpbdSolver::get_compliance(ConstraintType type) const {
+    return constraints[type].compliance;
+}
+
+void XpbdSolver::set_collision_radius(float radius) {
+    collision_radius = radius > 0.0f ? radius : 0.0f;
+}
+
+void XpbdSolver::set_iterations(int iterations) {
+    this->iterations = iterations > 0 ? iterations : 1;
+}
+
+static float distance(const ClothParticles& p, int i, int j) {
+    float dx = p.x[i] - p.x[j];
+    float dy = p.y[i] - p.y[j];
+    float dz = p.z[i] - p.z[j];
+    return sqrtf(dx * dx + dy * dy + dz * dz);
+}
+
+static void link(DistanceConstraints& c, const ClothParticles& p, int i, int j) {
+    c.add(i, j, distance(p, i, j));
+}
+
+// Links are emitted color by color (even links, then odd links, and so on).
+// Within a color they share no particles, so neighbouring iterations of a
+// loop over them do not wait on each other's stores either.
+void build_grid_links(const ClothParticles& p, DistanceConstraints links[CONSTRAINT_TYPES]) {
+    for (int t = 0; t < CONSTRAINT_TYPES; ++t)
+        links[t].clear();
+
+    const int rows = p.rows, cols = p.cols;
+    DistanceConstraints& structural = links[STRUCTURAL];
+    DistanceConstraints& shear = links[SHEAR];
+    DistanceConstraints& bending = links[BENDING];
+
+    for (int parity = 0; parity < 2; ++parity) {
+        structural.begin_color();
+        for (int i = 0; i < rows; ++i)
+            for (int j = parity; j + 1 < cols; j += 2)
+                link(structural, p, p.index(i, j), p.index(i, j + 1));
+    }
+    for (int parity = 0; parity < 2; ++parity) {
+        structural.begin_color();
+        for (int i = parity; i + 1 < rows; i += 2)
+            for (int j = 0; j < cols; ++j)
+                link(structural, p, p.index(i, j), p.index(i + 1, j));
+    }
+
+    for (int parity = 0; parity < 2; ++parity) {
+        shear.begin_color();
+        for (int i = parity; i + 1 < rows; i += 2)
+            for (int j = 0; j + 1 < cols; ++j)
+                link(shear, p, p.index(i, j), p.index(i + 1, j + 1));
+    }
+    for (int parity = 0; parity < 2; ++parity) {
+        shear.begin_color();
+        for (int i = parity; i + 1 < rows; i += 2)
+            for (int j = 0; j + 1 < cols; ++j)
+                link(shear, p, p.index(i, j + 1), p.index(i + 1, j));
+    }
+
+    // links two apart: (j, j + 2) and (j + 1, j + 3) share nothing when j % 4 < 2
+    for (int phase = 0; phase < 2; ++phase) {
+        bending.begin_color();
+        for (int i = 0; i < rows; ++i)
+            for (int j = 0; j + 2 < cols; ++j)
+                if ((j / 2) % 2 == phase)
+                    link(bending, p, p.index(i, j), p.index(i, j + 2));
+    }
+    for (int phase = 0; phase < 2; ++phase) {
+        bending.begin_color();
+        for (int i = 0; i + 2 < rows; ++i)
+            if ((i / 2) % 2 == phase)
+                for (int j = 0; j < cols; ++j)
+                    link(bending, p, p.index(i, j), p.index(i + 2, j));
+    }
+}
+
+void XpbdSolver::build(const ClothParticles& p) {
+    build_grid_links(p, constraints);
+    rest_x = p.x;
+    rest_y = p.y;
+    rest_z = p.z;
+    built = true;
+}
+
+// Particles per task of the parallel loops; smaller ranges cost more in
+// hand-off than they win.
+static const int GRAIN = 4096;
+
+void XpbdSolver::begin_step(const ClothParticles& p, JobSystem* jobs) {
+    PROFILE_ZONE("xpbd_begin");
+    // built here, before the first integrate, so rest lengths and rest
+    // positions come from the starting layout, not predicted positions
+    if (!built)
+        build(p);
+    const int n = p.size();
+    prev_x.resize(n);
+    prev_y.resize(n);
+    prev_z.resize(n);
+    parallel_for(jobs, n, GRAIN, [&](int begin, int end) {
+        std::copy(p.x.begin() + begin, p.x.begin() + end, prev_x.begin() + begin);
+        std::copy(p.y.begin() + begin, p.y.begin() + end, prev_y.begin() + begin);
+        std::copy(p.z.begin() + begin, p.z.begin() + end, prev_z.begin() + begin);
+    });
+}
+
+void XpbdSolver::solve(ClothParticles& p, float h, JobSystem* jobs) {
+    PROFILE_ZONE("xpbd_solve");
+    const float inv_h2 = 1.0f / (h * h);
+    for (int t = 0; t < CONSTRAINT_TYPES; ++t) {
+        DistanceConstraints& c = constraints[t];
+        std::fill(c.lambda.begin(), c.lambda.end(), 0.0f);
+    }
+
+    for (int it = 0; it < iterations; ++it) {
+        for (int t = 0; t < CONSTRAINT_TYPES; ++t)
+            project(constraints[t], p, constraints[t].compliance * inv_h2, jobs);
+    }
+    if (collision_radius > 0.0f)
+        collide(p);
+}
+
+void XpbdSolver::end_step(ClothParticles& p, float h, JobSystem* jobs) {
+    PROFILE_ZONE("xpbd_end");
+    const float inv_h = 1.0f / h;
+    const ClothKernels& kernels = cloth_kernels();
+    parallel_for(jobs, p.size(), GRAIN, [&](int begin, int end) {
+        kernels.update_velocity(p, prev_x.data(), prev_y.data(), prev_z.data(), begin, end, inv_h);
+    });
+}
+
+// One sweep over the constraints, color after color. alpha is the
+// compliance already divided by h^2. Constraints of one color share no
+// particle, so each color goes to the vector kernel and is split between
+// the threads without any locking; a color is finished before the next one
+// starts. The result does not depend on the thread count.
+void XpbdSolver::project(DistanceConstraints& c, ClothParticles& p, float alpha, JobSystem* jobs) {
+    const ClothKernels& kernels = cloth_kernels();
+    for (int color = 0; color < c.color_count(); ++color) {
+        const int first = c.color_begin(color);
+        parallel_for(jobs, c.color_end(color) - first, GRAIN, [&](int begin, int end) {
+            kernels.project_distance(p, c, first + begin, first + end, alpha);
+        });
+    }
+}
+
+// Pairs come from the hash built on the predicted positions and are pushed
+// apart one after another like rigid inequality constraints.
+void XpbdSolver::collide(ClothParticles& p) {
+    PROFILE_ZONE("xpbd_collide");
+    const float r = collision_radius;
+    const float r2 = r * r;
+    float* x = p.x.data();
+    float* y = p.y.data();
+    float* z = p.z.data();
+    const float* w = p.inv_mass.data();
+
+    hash.set_cell_size(r);
+    hash.build(x, y, z, p.size());
+    hash.for_each_pair(r, [&](int i, int j, float) {
+        float rx = rest_x[i] - rest_x[j], ry = rest_y[i] - rest_y[j], rz = rest_z[i] - rest_z[j];
+        if (rx * rx + ry * ry + rz * rz <= r2)
+            return;
+        float wsum = w[i] + w[j];
+        if (wsum == 0.0f)
+            return;
+
+        // earlier pairs may have moved the particles since the hash was built
+        float dx = x[i] - x[j], dy = y[i] - y[j], dz = z[i] - z[j];
+        float len2 = dx * dx + dy * dy + dz * dz;
+        if (len2 >= r2 || len2 < 1e-18f)
+            return;
+        float len = sqrtf(len2);
+        float s = (r - len) / (len * wsum);
+        x[i] += w[i] * s * dx; y[i] += w[i] * s * dy; z[i] += w[i] * s * dz;
+        x[j] -= w[j] * s * dx; y[j] -= w[j] * s * dy; z[j] -= w[j] * s * dz;
+    });
+}
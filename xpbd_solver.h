@@ -0,0 +1,106 @@
+#ifndef XPBD_SOLVER_H
+#define XPBD_SOLVER_H
+
+#include <cstddef>
+#include <vector>
+#include "spatial_hash.h"
+
+struct ClothParticles;
+class JobSystem;
+
+enum ConstraintType {
+    STRUCTURAL,     // direct neighbours in a row or a column
+    SHEAR,          // both diagonals of every grid cell
+    BENDING,        // particles two apart in a row or a column
+    CONSTRAINT_TYPES
+};
+
+// Distance constraints |p[a] - p[b]| = rest sharing one compliance.
+// Constraints are stored by color: no two constraints of one color share a
+// particle, so a color can be projected in any order or in parallel.
+struct DistanceConstraints {
+    std::vector<int> a, b;
+    std::vector<float> rest;
+    std::vector<float> lambda;      // accumulated Lagrange multiplier
+    std::vector<int> colors;        // index of the first constraint of every color
+    float compliance = 0.0f;        // inverse stiffness, 0 is rigid
+
+    void clear();
+    void add(int a, int b, float rest);
+    // Constraints added from now on belong to a new color.
+    void begin_color();
+
+    int size() const { return (int)a.size(); }
+    int color_count() const { return (int)colors.size(); }
+    int color_begin(int color) const { return colors[color]; }
+    int color_end(int color) const { return color + 1 < color_count() ? colors[color + 1] : size(); }
+};
+
+// Fills links with the structural, shear and bending pairs of the grid,
+// rest lengths are taken from the current particle positions. Every type
+// gets four colors: row and column parity for the structural links, row
+// parity of each diagonal for shear and pairs of columns or rows for bending.
+void build_grid_links(const ClothParticles& p, DistanceConstraints links[CONSTRAINT_TYPES]);
+
+// Extended position based dynamics over the cloth grid. Compliance is
+// scaled by 1 / h^2 every substep, so the material stiffness is the same
+// whatever time step, substep and iteration counts are used; those only
+// trade accuracy for speed.
+class XpbdSolver {
+public:
+    XpbdSolver();
+
+    // Creates the constraints of the grid, rest lengths are taken from the
+    // current particle positions.
+    void build(const ClothParticles& p);
+    bool is_built() const { return built; }
+
+    void set_compliance(ConstraintType type, float compliance);
+    float get_compliance(ConstraintType type) const;
+    void set_iterations(int iterations);
+    int get_iterations() const { return iterations; }
+    void set_substeps(int substeps);
+    int get_substeps() const { return substeps; }
+
+    // Self collision: particles are pushed apart until they are at least
+    // radius from each other, found through a spatial hash every substep.
+    // Pairs that were already closer than radius at rest are left to the
+    // distance constraints. 0, the default, turns it off.
+    void set_collision_radius(float radius);
+    float get_collision_radius() const { return collision_radius; }
+
+    const DistanceConstraints& get_constraints(ConstraintType type) const { return constraints[type]; }
+
+    // Remembers positions at the start of a substep. Must be called before
+    // the particles are moved to their predicted positions. The first call
+    // builds the constraints if build() was not called.
+    void begin_step(const ClothParticles& p, JobSystem* jobs = NULL);
+
+    // Projects the predicted positions onto the constraints. With a job
+    // system every color is split between its threads.
+    void solve(ClothParticles& p, float h, JobSystem* jobs = NULL);
+
+    // Derives the new velocities from the total displacement of the substep
+    // h, once solve() and any other position corrections are done.
+    void end_step(ClothParticles& p, float h, JobSystem* jobs = NULL);
+
+    // Positions remembered by begin_step().
+    const std::vector<float>& previous_x() const { return prev_x; }
+    const std::vector<float>& previous_y() const { return prev_y; }
+    const std::vector<float>& previous_z() const { return prev_z; }
+
+private:
+    void project(DistanceConstraints& c, ClothParticles& p, float alpha, JobSystem* jobs);
+    void collide(ClothParticles& p);
+
+    DistanceConstraints constraints[CONSTRAINT_TYPES];
+    std::vector<float> prev_x, prev_y, prev_z;
+    std::vector<float> rest_x, rest_y, rest_z;      // positions at build()
+    SpatialHash hash;
+    float collision_radius;
+    int iterations;     // sweeps over all colors per substep
+    int substeps;       // substeps per ClothSolver::step
+    bool built;
+};
+
+#endif